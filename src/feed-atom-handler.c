@@ -30,19 +30,21 @@
 #include "feed-atom-handler.h"
 #include "utils.h"
 #include "feed-handler.h"
+#include "feed-item-private.h"
 #include "ns-handler.h"
 
 #define FEED_ATOM_HANDLER_GET_PRIVATE(o)	(G_TYPE_INSTANCE_GET_PRIVATE ((o), FEED_ATOM_HANDLER_TYPE, FeedAtomHandlerPrivate))
 #define FEED_ATOM_HANDLER_ERROR			feed_atom_handler_error_quark()
 #define ATOM10_NS				BAD_CAST"http://www.w3.org/2005/Atom"
 
-typedef void 	(*AtomChannelParserFunc)	(xmlNodePtr cur, GrssFeedChannel *feed);
-typedef void 	(*AtomItemParserFunc)		(xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed);
+typedef void 	(*AtomChannelParserFunc)	(xmlNodePtr cur, GrssFeedChannel *feed, FeedParseContext *context);
+typedef void 	(*AtomItemParserFunc)		(xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed, FeedParseContext *context);
 
 struct FeedAtomHandlerPrivate {
 	NSHandler	*handler;
 	GHashTable	*feed_elements_hash;
 	GHashTable	*entry_elements_hash;
+	GHashTable	*entry_fields_hash;
 };
 
 enum {
@@ -63,6 +65,13 @@ feed_atom_handler_error_quark ()
 static void
 feed_atom_handler_finalize (GObject *object)
 {
+	FeedAtomHandler *parser;
+
+	parser = FEED_ATOM_HANDLER (object);
+	g_hash_table_destroy (parser->priv->feed_elements_hash);
+	g_hash_table_destroy (parser->priv->entry_elements_hash);
+	g_hash_table_destroy (parser->priv->entry_fields_hash);
+
 	G_OBJECT_CLASS (feed_atom_handler_parent_class)->finalize (object);
 }
 
@@ -75,32 +84,27 @@ feed_atom_handler_set_ns_handler (FeedHandler *self, NSHandler *handler)
 	atom->priv->handler = handler;
 }
 
-static gboolean
-feed_atom_handler_check_format (FeedHandler *self, xmlDocPtr doc, xmlNodePtr cur)
+static const gchar**
+feed_atom_handler_get_roots (FeedHandler *self)
 {
-	if (cur->name == NULL || cur->ns == NULL || cur->ns->href == NULL)
-		return FALSE;
-	return xmlStrEqual (cur->name, BAD_CAST"feed") && xmlStrEqual (cur->ns->href, ATOM10_NS);
+	static const gchar *roots [] = {"feed|http://www.w3.org/2005/Atom", NULL};
+
+	return roots;
 }
 
-static xmlChar *
+/* for bases not coming from feed_parse_context_get_base(), still to be escaped */
+static gchar *
 common_build_url (const gchar *url, const gchar *baseURL)
 {
-	xmlChar	*escapedURL;
-	xmlChar	*absURL;
+	gchar	*absURL;
 	xmlChar	*escapedBaseURL;
 
-	escapedURL = xmlURIEscape (BAD_CAST url);
+	if (baseURL == NULL)
+		return resolve_url (url, NULL);
 
-	if (baseURL) {
-		escapedBaseURL = xmlURIEscape (BAD_CAST baseURL);
-		absURL = xmlBuildURI (escapedURL, escapedBaseURL);
-		xmlFree (escapedURL);
-		xmlFree (escapedBaseURL);
-	}
-	else {
-		absURL = escapedURL;
-	}
+	escapedBaseURL = xmlURIEscape (BAD_CAST baseURL);
+	absURL = resolve_url (url, (gchar*) escapedBaseURL);
+	xmlFree (escapedBaseURL);
 
 	return absURL;
 }
@@ -155,7 +159,7 @@ atom10_mark_up_text_content (gchar* content)
  * @returns g_strduped string which must be freed by the caller.
  */
 static gchar*
-atom10_parse_content_construct (xmlNodePtr cur)
+atom10_parse_content_construct (xmlNodePtr cur, FeedParseContext *context)
 {
 	gchar *ret = NULL;
 
@@ -166,14 +170,12 @@ atom10_parse_content_construct (xmlNodePtr cur)
 			ret = NULL;
 		}
 		else {
-			gchar *baseURL = (gchar*) xmlNodeGetBase (cur->doc, cur);
-			xmlChar *url;
+			gchar *url;
 
-			url = common_build_url (src, baseURL);
+			url = resolve_url (src, feed_parse_context_get_base (context, cur));
 			ret = g_strdup_printf ("<p><a href=\"%s\">View this item's content.</a></p>", url);
 
 			g_free (url);
-			xmlFree (baseURL);
 			xmlFree (src);
 		}
 	}
@@ -323,7 +325,7 @@ atom10_parse_person_construct (xmlNodePtr cur)
 
 /* Note: this function is called for both item and feed context */
 static gchar *
-atom10_parse_link (xmlNodePtr cur, GrssFeedChannel *feed, GrssFeedItem *item)
+atom10_parse_link (xmlNodePtr cur, GrssFeedChannel *feed, GrssFeedItem *item, FeedParseContext *context)
 {
 	gchar *href;
 	const gchar *home;
@@ -334,14 +336,15 @@ atom10_parse_link (xmlNodePtr cur, GrssFeedChannel *feed, GrssFeedItem *item)
 	href = (gchar*) xmlGetNsProp (cur, BAD_CAST"href", NULL);
 
 	if (href) {
-		xmlChar *baseURL = xmlNodeGetBase (cur->doc, cur);
+		const gchar *baseURL = feed_parse_context_get_base (context, cur);
 		gchar *url, *relation, *type, *escTitle = NULL, *title;
 
 		home = grss_feed_channel_get_homepage (feed);
 
 		if (!baseURL && home && strstr (home, "://"))
-			baseURL = xmlStrdup (BAD_CAST home);
-		url = (gchar*) common_build_url (href, (gchar*) baseURL);
+			url = common_build_url (href, home);
+		else
+			url = resolve_url (href, baseURL);
 
 		type = (gchar*) xmlGetNsProp (cur, BAD_CAST"type", NULL);
 		relation = (gchar*) xmlGetNsProp (cur, BAD_CAST"rel", NULL);
@@ -355,9 +358,8 @@ atom10_parse_link (xmlNodePtr cur, GrssFeedChannel *feed, GrssFeedItem *item)
 		}
 		else if (g_str_equal (relation, "replies")) {
 			if (item != NULL && (!type || g_str_equal (type, BAD_CAST"application/atom+xml"))) {
-				gchar *commentUri = (gchar*) common_build_url ((gchar*) url, home);
-				grss_feed_item_set_comments_url (item, commentUri);
-				g_free (commentUri);
+				gchar *commentUri = common_build_url (url, home);
+				grss_feed_item_set_comments_url_take (item, commentUri);
 			}
 		}
 		else if (g_str_equal (relation, "enclosure")) {
@@ -393,7 +395,6 @@ atom10_parse_link (xmlNodePtr cur, GrssFeedChannel *feed, GrssFeedItem *item)
 		}
 
 		xmlFree (title);
-		xmlFree (baseURL);
 		g_free (escTitle);
 		g_free (url);
 		g_free (relation);
@@ -408,7 +409,7 @@ atom10_parse_link (xmlNodePtr cur, GrssFeedChannel *feed, GrssFeedItem *item)
 }
 
 static void
-atom10_parse_entry_author (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed)
+atom10_parse_entry_author (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	GrssPerson *author;
 
@@ -420,7 +421,7 @@ atom10_parse_entry_author (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *
 }
 
 static void
-atom10_parse_entry_category (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed)
+atom10_parse_entry_category (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *category = NULL;
 
@@ -436,20 +437,49 @@ atom10_parse_entry_category (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel
 	}
 }
 
+/*
+ * Escaped HTML may be converted only when required, see
+ * grss_feed_item_set_description_from_node()
+ */
+static gboolean
+atom10_is_escaped_html (xmlNodePtr cur, gboolean content)
+{
+	gchar *type;
+	gboolean ret;
+
+	if (content && xmlHasNsProp (cur, BAD_CAST"src", NULL))
+		return FALSE;
+
+	type = (gchar*) xmlGetNsProp (cur, BAD_CAST"type", NULL);
+	if (type == NULL)
+		return FALSE;
+
+	if (content)
+		ret = (g_str_equal (type, "html") || !g_ascii_strcasecmp (type, "text/html"));
+	else
+		ret = g_str_equal (type, "html");
+
+	g_free (type);
+	return ret;
+}
+
 static void
-atom10_parse_entry_content (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed)
+atom10_parse_entry_content (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *content;
 
-	content = atom10_parse_content_construct (cur);
-	if (content) {
-		grss_feed_item_set_description (item, content);
-		g_free (content);
+	if (atom10_is_escaped_html (cur, TRUE)) {
+		grss_feed_item_set_description_from_node (item, cur, NULL);
+	}
+	else {
+		content = atom10_parse_content_construct (cur, context);
+		if (content)
+			grss_feed_item_set_description_take (item, content);
 	}
 }
 
 static void
-atom10_parse_entry_contributor (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed)
+atom10_parse_entry_contributor (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	GrssPerson *contributor;
 
@@ -461,72 +491,70 @@ atom10_parse_entry_contributor (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChan
 }
 
 static void
-atom10_parse_entry_id (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed)
+atom10_parse_entry_id (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *id;
 
 	id = (gchar*) xmlNodeListGetString (cur->doc, cur->xmlChildrenNode, 1);
 	if (id) {
 		if (strlen (id) > 0)
-			grss_feed_item_set_id (item, id);
-		g_free (id);
+			grss_feed_item_set_id_take (item, id);
+		else
+			g_free (id);
 	}
 }
 
 static void
-atom10_parse_entry_link (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed)
+atom10_parse_entry_link (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *href;
 
-	href = atom10_parse_link (cur, feed, item);
-	if (href) {
-		grss_feed_item_set_source (item, href);
-		g_free (href);
-	}
+	href = atom10_parse_link (cur, feed, item, context);
+	if (href)
+		grss_feed_item_set_source_take (item, href);
 }
 
 static void
-atom10_parse_entry_rights (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed)
+atom10_parse_entry_rights (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *rights;
 
 	rights = atom10_parse_text_construct (cur, FALSE);
-	if (rights) {
-		grss_feed_item_set_copyright (item, rights);
-		g_free (rights);
-	}
+	if (rights)
+		grss_feed_item_set_copyright_take (item, rights);
 }
 
 /* <summary> can be used for short text descriptions, if there is no
    <content> description we show the <summary> content */
 static void
-atom10_parse_entry_summary (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed)
+atom10_parse_entry_summary (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *summary;
 
-	summary = atom10_parse_text_construct (cur, TRUE);
-	if (summary) {
-		grss_feed_item_set_description (item, summary);
-		g_free (summary);
+	if (atom10_is_escaped_html (cur, FALSE)) {
+		grss_feed_item_set_description_from_node (item, cur, NULL);
+	}
+	else {
+		summary = atom10_parse_text_construct (cur, TRUE);
+		if (summary)
+			grss_feed_item_set_description_take (item, summary);
 	}
 
 	/* FIXME: set a flag to show a "Read more" link to the user; but where? */
 }
 
 static void
-atom10_parse_entry_title (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed)
+atom10_parse_entry_title (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *title;
 
 	title = atom10_parse_text_construct (cur, FALSE);
-	if (title) {
-		grss_feed_item_set_title (item, title);
-		g_free (title);
-	}
+	if (title)
+		grss_feed_item_set_title_take (item, title);
 }
 
 static void
-atom10_parse_entry_published (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed)
+atom10_parse_entry_published (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *datestr;
 	time_t t;
@@ -542,16 +570,56 @@ atom10_parse_entry_published (xmlNodePtr cur, GrssFeedItem *item, GrssFeedChanne
 	g_free (datestr);
 }
 
+/* the last not empty <id> wins, as in atom10_parse_entry_id() */
+static gchar*
+atom10_peek_entry_id (FeedHandler *self, FeedParseContext *context, xmlNodePtr cur)
+{
+	gchar *id;
+	gchar *ret;
+	FeedAtomHandler *parser;
+
+	parser = FEED_ATOM_HANDLER (self);
+	ret = NULL;
+
+	for (cur = cur->xmlChildrenNode; cur; cur = cur->next) {
+		if (cur->type != XML_ELEMENT_NODE || cur->ns == NULL || cur->ns->href == NULL)
+			continue;
+
+		if (ns_handler_handles_item (parser->priv->handler, &context->ns_cache, cur))
+			continue;
+
+		if (xmlStrcmp (cur->ns->href, ATOM10_NS) || xmlStrcmp (cur->name, BAD_CAST"id"))
+			continue;
+
+		id = (gchar*) xmlNodeListGetString (cur->doc, cur->xmlChildrenNode, 1);
+		if (id) {
+			if (strlen (id) > 0) {
+				g_free (ret);
+				ret = id;
+			}
+			else {
+				g_free (id);
+			}
+		}
+	}
+
+	return ret;
+}
+
 /* <content> tag support, FIXME: base64 not supported */
 /* method to parse standard tags for each item element */
 static GrssFeedItem*
-atom10_parse_entry (FeedHandler *self, GrssFeedChannel *feed, xmlNodePtr cur)
+atom10_parse_entry (FeedHandler *self, GrssFeedChannel *feed, xmlNodePtr cur, FeedParseContext *context)
 {
 	AtomItemParserFunc func;
 	FeedAtomHandler *parser;
 	GrssFeedItem *item;
 
-	item = grss_feed_item_new (feed);
+	if (feed_parse_context_is_full (context) ||
+	    feed_parse_context_skip_node (context, self, feed, cur, atom10_peek_entry_id))
+		return NULL;
+
+	item = feed_parse_context_new_item (context, feed, cur);
 	parser = FEED_ATOM_HANDLER (self);
 	cur = cur->xmlChildrenNode;
 
@@ -563,7 +631,7 @@ atom10_parse_entry (FeedHandler *self, GrssFeedChannel *feed, xmlNodePtr cur)
 
 		/* check namespace of this tag */
 		if (cur->ns) {
-			if (ns_handler_item (parser->priv->handler, item, cur)) {
+			if (ns_handler_item (parser->priv->handler, &context->ns_cache, item, cur, context->fields)) {
 				cur = cur->next;
 				continue;
 			}
@@ -584,7 +652,9 @@ atom10_parse_entry (FeedHandler *self, GrssFeedChannel *feed, xmlNodePtr cur)
 		/* At this point, the namespace must be the Atom 1.0 namespace */
 		func = g_hash_table_lookup (parser->priv->entry_elements_hash, cur->name);
 		if (func) {
-			(*func) (cur, item, feed);
+			if (context->fields == GRSS_FEED_PARSER_FIELDS_ALL ||
+			    !feed_parse_context_skip_field (context, GPOINTER_TO_UINT (g_hash_table_lookup (parser->priv->entry_fields_hash, cur->name))))
+				(*func) (cur, item, feed, context);
 		}
 
 		cur = cur->next;
@@ -594,7 +664,7 @@ atom10_parse_entry (FeedHandler *self, GrssFeedChannel *feed, xmlNodePtr cur)
 }
 
 static void
-atom10_parse_feed_author (xmlNodePtr cur, GrssFeedChannel *feed)
+atom10_parse_feed_author (xmlNodePtr cur, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	GrssPerson *author;
 
@@ -606,7 +676,7 @@ atom10_parse_feed_author (xmlNodePtr cur, GrssFeedChannel *feed)
 }
 
 static void
-atom10_parse_feed_category (xmlNodePtr cur, GrssFeedChannel *feed)
+atom10_parse_feed_category (xmlNodePtr cur, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *label = NULL;
 
@@ -623,7 +693,7 @@ atom10_parse_feed_category (xmlNodePtr cur, GrssFeedChannel *feed)
 }
 
 static void
-atom10_parse_feed_contributor (xmlNodePtr cur, GrssFeedChannel *feed)
+atom10_parse_feed_contributor (xmlNodePtr cur, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	/* parse feed contributors */
 	GrssPerson *contributor;
@@ -636,7 +706,7 @@ atom10_parse_feed_contributor (xmlNodePtr cur, GrssFeedChannel *feed)
 }
 
 static void
-atom10_parse_feed_generator (xmlNodePtr cur, GrssFeedChannel *feed)
+atom10_parse_feed_generator (xmlNodePtr cur, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *ret;
 	gchar *version;
@@ -668,7 +738,7 @@ atom10_parse_feed_generator (xmlNodePtr cur, GrssFeedChannel *feed)
 }
 
 static void
-atom10_parse_feed_icon (xmlNodePtr cur, GrssFeedChannel *feed)
+atom10_parse_feed_icon (xmlNodePtr cur, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *icon_uri;
 
@@ -680,11 +750,11 @@ atom10_parse_feed_icon (xmlNodePtr cur, GrssFeedChannel *feed)
 }
 
 static void
-atom10_parse_feed_link (xmlNodePtr cur, GrssFeedChannel *feed)
+atom10_parse_feed_link (xmlNodePtr cur, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *href;
 
-	href = atom10_parse_link (cur, feed, NULL);
+	href = atom10_parse_link (cur, feed, NULL, context);
 	if (href) {
 		xmlChar *baseURL = xmlNodeGetBase (cur->doc, xmlDocGetRootElement (cur->doc));
 		grss_feed_channel_set_homepage (feed, href);
@@ -700,7 +770,7 @@ atom10_parse_feed_link (xmlNodePtr cur, GrssFeedChannel *feed)
 }
 
 static void
-atom10_parse_feed_logo (xmlNodePtr cur, GrssFeedChannel *feed)
+atom10_parse_feed_logo (xmlNodePtr cur, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *logo;
 
@@ -712,43 +782,37 @@ atom10_parse_feed_logo (xmlNodePtr cur, GrssFeedChannel *feed)
 }
 
 static void
-atom10_parse_feed_rights (xmlNodePtr cur, GrssFeedChannel *feed)
+atom10_parse_feed_rights (xmlNodePtr cur, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *rights;
 
 	rights = atom10_parse_text_construct (cur, FALSE);
-	if (rights) {
-		grss_feed_channel_set_copyright (feed, rights);
-		g_free (rights);
-	}
+	if (rights)
+		grss_feed_channel_set_copyright_take (feed, rights);
 }
 
 static void
-atom10_parse_feed_subtitle (xmlNodePtr cur, GrssFeedChannel *feed)
+atom10_parse_feed_subtitle (xmlNodePtr cur, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *subtitle;
 
 	subtitle = atom10_parse_text_construct (cur, TRUE);
-	if (subtitle) {
- 		grss_feed_channel_set_description (feed, subtitle);
-		g_free (subtitle);
-	}
+	if (subtitle)
+		grss_feed_channel_set_description_take (feed, subtitle);
 }
 
 static void
-atom10_parse_feed_title (xmlNodePtr cur, GrssFeedChannel *feed)
+atom10_parse_feed_title (xmlNodePtr cur, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *title;
 
 	title = atom10_parse_text_construct (cur, FALSE);
-	if (title) {
-		grss_feed_channel_set_title (feed, title);
-		g_free (title);
-	}
+	if (title)
+		grss_feed_channel_set_title_take (feed, title);
 }
 
 static void
-atom10_parse_feed_updated (xmlNodePtr cur, GrssFeedChannel *feed)
+atom10_parse_feed_updated (xmlNodePtr cur, GrssFeedChannel *feed, FeedParseContext *context)
 {
 	gchar *timestamp;
 	time_t t;
@@ -763,7 +827,7 @@ atom10_parse_feed_updated (xmlNodePtr cur, GrssFeedChannel *feed)
 }
 
 static GList*
-feed_atom_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, GError **error)
+feed_atom_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, FeedParseContext *context, GError **error)
 {
 	time_t now;
 	xmlNodePtr cur;
@@ -782,13 +846,18 @@ feed_atom_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc
 	parser = FEED_ATOM_HANDLER (self);
 
 	while (TRUE) {
-		if (!cur || xmlStrcmp (cur->name, BAD_CAST"feed")) {
+		if (context->resume != NULL) {
+			/* a parsing split in slices continues from where it stopped */
+			cur = feed_parse_context_resume (context);
+		}
+		else if (!cur || xmlStrcmp (cur->name, BAD_CAST"feed")) {
 			g_set_error (error, FEED_ATOM_HANDLER_ERROR, FEED_ATOM_HANDLER_PARSE_ERROR, "Could not find Atom 1.0 header!");
 			break;
 		}
-
-		/* parse feed contents */
-		cur = cur->xmlChildrenNode;
+		else {
+			/* parse feed contents */
+			cur = cur->xmlChildrenNode;
+		}
 
 		while (cur) {
 		 	if (!cur->name || cur->type != XML_ELEMENT_NODE || !cur->ns) {
@@ -796,11 +865,14 @@ feed_atom_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc
 				continue;
 			}
 
+			if (do_items == TRUE && feed_parse_context_yield (context, cur))
+				break;
+
 			/* check if supported namespace should handle the current tag
 			   by trying to determine a namespace handler */
 
 			if (cur->ns) {
-				if (ns_handler_channel (parser->priv->handler, feed, cur)) {
+				if (ns_handler_channel (parser->priv->handler, &context->ns_cache, feed, cur)) {
 					cur = cur->next;
 					continue;
 				}
@@ -817,15 +889,12 @@ feed_atom_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc
 
 			func = g_hash_table_lookup (parser->priv->feed_elements_hash, cur->name);
 			if (func) {
-				(*func) (cur, feed);
+				(*func) (cur, feed, context);
 			}
 			else if (do_items == TRUE && xmlStrEqual (cur->name, BAD_CAST"entry")) {
-				item = atom10_parse_entry (self, feed, cur);
-				if (item) {
-					if (grss_feed_item_get_publish_time (item) == 0)
-						grss_feed_item_set_publish_time (item, now);
+				item = atom10_parse_entry (self, feed, cur, context);
+				if (item && feed_parse_context_collect_item (context, feed, item, now))
 					items = g_list_append (items, item);
-				}
 			}
 
 			cur = cur->next;
@@ -839,6 +908,8 @@ feed_atom_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc
 
 	grss_feed_channel_set_format (feed, "application/atom+xml");
 
+	context->reversed = TRUE;
+
 	if (items != NULL)
 		items = g_list_reverse (items);
 	return items;
@@ -848,7 +919,7 @@ static void
 feed_handler_interface_init (FeedHandlerInterface *iface)
 {
 	iface->set_ns_handler = feed_atom_handler_set_ns_handler;
-	iface->check_format = feed_atom_handler_check_format;
+	iface->get_roots = feed_atom_handler_get_roots;
 	iface->parse = feed_atom_handler_parse;
 }
 
@@ -896,6 +967,18 @@ feed_atom_handler_init (FeedAtomHandler *object)
 	g_hash_table_insert (hash, "title", &atom10_parse_entry_title);
 	g_hash_table_insert (hash, "updated", &atom10_parse_entry_published);
 	object->priv->entry_elements_hash = hash;
+
+	/* fields of the parser provided by the elements, the others are
+	   always parsed */
+	hash = g_hash_table_new (g_str_hash, g_str_equal);
+	g_hash_table_insert (hash, "author", GUINT_TO_POINTER (GRSS_FEED_PARSER_FIELD_AUTHORS));
+	g_hash_table_insert (hash, "category", GUINT_TO_POINTER (GRSS_FEED_PARSER_FIELD_CATEGORIES));
+	g_hash_table_insert (hash, "content", GUINT_TO_POINTER (GRSS_FEED_PARSER_FIELD_DESCRIPTION));
+	g_hash_table_insert (hash, "contributor", GUINT_TO_POINTER (GRSS_FEED_PARSER_FIELD_AUTHORS));
+	g_hash_table_insert (hash, "rights", GUINT_TO_POINTER (GRSS_FEED_PARSER_FIELD_RIGHTS));
+	g_hash_table_insert (hash, "summary", GUINT_TO_POINTER (GRSS_FEED_PARSER_FIELD_DESCRIPTION));
+	g_hash_table_insert (hash, "title", GUINT_TO_POINTER (GRSS_FEED_PARSER_FIELD_TITLE));
+	object->priv->entry_fields_hash = hash;
 }
 
 FeedAtomHandler*
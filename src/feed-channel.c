@@ -21,7 +21,9 @@
 
 #include "utils.h"
 #include "feed-channel.h"
+#include "feed-channel-private.h"
 #include "feed-parser.h"
+#include "feed-parser-private.h"
 
 #define FEED_CHANNEL_GET_PRIVATE(obj)	(G_TYPE_INSTANCE_GET_PRIVATE ((obj), GRSS_FEED_CHANNEL_TYPE, GrssFeedChannelPrivate))
 #define FEED_CHANNEL_ERROR		feed_channel_error_quark()
@@ -67,6 +69,10 @@ struct _GrssFeedChannelPrivate {
 	time_t		pub_time;
 	time_t		update_time;
 	int		update_interval;
+	guint		max_items;
+
+	GrssFeedChannelEncoding encoding;
+	gchar		*charset;
 
 	GCancellable	*fetchcancel;
 };
@@ -97,8 +103,8 @@ grss_feed_channel_finalize (GObject *obj)
 	FREE_STRING (chan->priv->description);
 	FREE_STRING (chan->priv->image);
 	FREE_STRING (chan->priv->icon);
-	FREE_STRING (chan->priv->language);
-	FREE_STRING (chan->priv->category);
+	FREE_INTERNED (chan->priv->language);
+	FREE_INTERNED (chan->priv->category);
 	FREE_STRING (chan->priv->pubsub.hub);
 	FREE_STRING (chan->priv->rsscloud.path);
 	FREE_STRING (chan->priv->rsscloud.protocol);
@@ -106,7 +112,8 @@ grss_feed_channel_finalize (GObject *obj)
 	if (chan->priv->editor)
 		grss_person_unref (chan->priv->editor);
 	FREE_STRING (chan->priv->webmaster);
-	FREE_STRING (chan->priv->generator);
+	FREE_INTERNED (chan->priv->generator);
+	FREE_INTERNED (chan->priv->charset);
 
 	if (chan->priv->contributors != NULL) {
 		for (iter = chan->priv->contributors; iter; iter = g_list_next (iter))
@@ -200,6 +207,48 @@ grss_feed_channel_new_from_xml (xmlDocPtr doc, GError **error)
 	return ret;
 }
 
+/*
+ * Contents are passed to the parser as they are, so that also documents
+ * which are not XML (as JSON Feeds) are recognized
+ */
+/* if @data is NULL, the file in @url is parsed */
+static GrssFeedChannel*
+new_from_contents (const gchar *data, gsize size, const gchar *url, const gchar *parse_message, GError **error)
+{
+	GError *myerror;
+	GrssFeedParser *parser;
+	GrssFeedChannel *ret;
+
+	ret = g_object_new (GRSS_FEED_CHANNEL_TYPE, NULL);
+	parser = grss_feed_parser_new ();
+
+	myerror = NULL;
+	if (data != NULL)
+		grss_feed_parser_parse_data_full (parser, ret, data, size, url, NULL, FALSE, &myerror);
+	else
+		grss_feed_parser_parse_file_full (parser, ret, url, FALSE, &myerror);
+
+	if (myerror != NULL) {
+		g_object_unref (ret);
+		ret = NULL;
+
+		if (g_error_matches (myerror, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR)) {
+			g_error_free (myerror);
+			g_set_error (error, FEED_CHANNEL_ERROR, FEED_CHANNEL_PARSE_ERROR, "%s", parse_message);
+		}
+		else if (myerror->domain == G_FILE_ERROR) {
+			g_set_error (error, FEED_CHANNEL_ERROR, FEED_CHANNEL_FILE_ERROR, "Unable to open file: %s", myerror->message);
+			g_error_free (myerror);
+		}
+		else {
+			g_propagate_error (error, myerror);
+		}
+	}
+
+	g_object_unref (parser);
+	return ret;
+}
+
 /**
  * grss_feed_channel_new_from_memory:
  * @data: string to parse.
@@ -214,15 +263,7 @@ grss_feed_channel_new_from_xml (xmlDocPtr doc, GError **error)
 GrssFeedChannel*
 grss_feed_channel_new_from_memory (const gchar *data, GError **error)
 {
-	xmlDocPtr doc;
-
-	doc = content_to_xml (data, strlen (data));
-	if (doc == NULL) {
-		g_set_error (error, FEED_CHANNEL_ERROR, FEED_CHANNEL_PARSE_ERROR, "Unable to parse data");
-		return NULL;
-	}
-
-	return grss_feed_channel_new_from_xml (doc, error);
+	return new_from_contents (data, strlen (data), NULL, "Unable to parse data", error);
 }
 
 /**
@@ -241,26 +282,70 @@ GrssFeedChannel*
 grss_feed_channel_new_from_file (const gchar *path, GError **error)
 {
 	struct stat sbuf;
-	xmlDocPtr doc;
-	GrssFeedChannel *ret;
-
-	ret = NULL;
 
 	if (stat (path, &sbuf) == -1) {
 		g_set_error (error, FEED_CHANNEL_ERROR, FEED_CHANNEL_FILE_ERROR, "Unable to open file: %s", strerror (errno));
 		return NULL;
 	}
 
-	doc = file_to_xml (path);
-	if (doc == NULL) {
-		g_set_error (error, FEED_CHANNEL_ERROR, FEED_CHANNEL_PARSE_ERROR, "Unable to parse file");
-		return NULL;
-	}
+	return new_from_contents (NULL, 0, path, "Unable to parse file", error);
+}
+
+static void
+new_from_file_thread (GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+	GError *error;
+	GrssFeedChannel *channel;
 
-	ret = grss_feed_channel_new_from_xml (doc, error);
+	error = NULL;
+	channel = grss_feed_channel_new_from_file (task_data, &error);
 
-	xmlFreeDoc (doc);
-	return ret;
+	if (channel != NULL)
+		g_task_return_pointer (task, channel, g_object_unref);
+	else
+		g_task_return_error (task, error);
+}
+
+/**
+ * grss_feed_channel_new_from_file_async:
+ * @path: path of the file to parse.
+ * @cancellable: (allow-none): optional #GCancellable object, or %NULL.
+ * @callback: function to invoke at the end of the parsing.
+ * @user_data: (closure): data passed to the callback.
+ *
+ * Similar to grss_feed_channel_new_from_file(), but the file is parsed in
+ * another thread, without blocking the main loop of the caller. The result
+ * has to be obtained with grss_feed_channel_new_from_file_finish() in
+ * @callback.
+ */
+void
+grss_feed_channel_new_from_file_async (const gchar *path, GCancellable *cancellable,
+                                       GAsyncReadyCallback callback, gpointer user_data)
+{
+	GTask *task;
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, g_strdup (path), g_free);
+	g_task_run_in_thread (task, new_from_file_thread);
+	g_object_unref (task);
+}
+
+/**
+ * grss_feed_channel_new_from_file_finish:
+ * @res: the #GAsyncResult passed to the callback.
+ * @error: if an error occurred, %NULL is returned and this is filled with the
+ *         message.
+ *
+ * Finalizes an operation started with grss_feed_channel_new_from_file_async().
+ *
+ * Returns: (transfer full): a #GrssFeedChannel, or %NULL if the file is not
+ * a valid document.
+ */
+GrssFeedChannel*
+grss_feed_channel_new_from_file_finish (GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (res, NULL), NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
 }
 
 /**
@@ -343,6 +428,20 @@ grss_feed_channel_set_title (GrssFeedChannel *channel, gchar *title)
 	channel->priv->title = g_strdup (title);
 }
 
+/**
+ * grss_feed_channel_set_title_take:
+ * @channel: a #GrssFeedChannel.
+ * @title: (transfer full): title of the feed.
+ *
+ * As grss_feed_channel_set_title(), but @channel takes ownership of @title.
+ */
+void
+grss_feed_channel_set_title_take (GrssFeedChannel *channel, gchar *title)
+{
+	FREE_STRING (channel->priv->title);
+	channel->priv->title = title;
+}
+
 /**
  * grss_feed_channel_get_title:
  * @channel: a #GrssFeedChannel.
@@ -380,6 +479,31 @@ grss_feed_channel_set_homepage (GrssFeedChannel *channel, gchar *homepage)
 	}
 }
 
+/**
+ * grss_feed_channel_set_homepage_take:
+ * @channel: a #GrssFeedChannel.
+ * @homepage: (transfer full): homepage for the main website.
+ *
+ * As grss_feed_channel_set_homepage(), but @channel takes ownership of
+ * @homepage. If @homepage is not a valid URL it is freed.
+ *
+ * Returns: %TRUE if @homepage is a valid URL, %FALSE otherwise
+ */
+gboolean
+grss_feed_channel_set_homepage_take (GrssFeedChannel *channel, gchar *homepage)
+{
+	FREE_STRING (channel->priv->homepage);
+
+	if (test_url ((const gchar*) homepage) == TRUE) {
+		channel->priv->homepage = homepage;
+		return TRUE;
+	}
+	else {
+		g_free (homepage);
+		return FALSE;
+	}
+}
+
 /**
  * grss_feed_channel_get_homepage:
  * @channel: a #GrssFeedChannel.
@@ -408,6 +532,21 @@ grss_feed_channel_set_description (GrssFeedChannel *channel, gchar *description)
 	channel->priv->description = g_strdup (description);
 }
 
+/**
+ * grss_feed_channel_set_description_take:
+ * @channel: a #GrssFeedChannel.
+ * @description: (transfer full): description of the feed.
+ *
+ * As grss_feed_channel_set_description(), but @channel takes ownership of
+ * @description.
+ */
+void
+grss_feed_channel_set_description_take (GrssFeedChannel *channel, gchar *description)
+{
+	FREE_STRING (channel->priv->description);
+	channel->priv->description = description;
+}
+
 /**
  * grss_feed_channel_get_description:
  * @channel: a #GrssFeedChannel.
@@ -507,8 +646,8 @@ grss_feed_channel_get_icon (GrssFeedChannel *channel)
 void
 grss_feed_channel_set_language (GrssFeedChannel *channel, gchar *language)
 {
-	FREE_STRING (channel->priv->language);
-	channel->priv->language = g_strdup (language);
+	FREE_INTERNED (channel->priv->language);
+	channel->priv->language = intern_string (language);
 }
 
 /**
@@ -535,8 +674,8 @@ grss_feed_channel_get_language (GrssFeedChannel *channel)
 void
 grss_feed_channel_set_category (GrssFeedChannel *channel, gchar *category)
 {
-	FREE_STRING (channel->priv->category);
-	channel->priv->category = g_strdup (category);
+	FREE_INTERNED (channel->priv->category);
+	channel->priv->category = intern_string (category);
 }
 
 /**
@@ -653,6 +792,21 @@ grss_feed_channel_set_copyright (GrssFeedChannel *channel, gchar *copyright)
 	channel->priv->copyright = g_strdup (copyright);
 }
 
+/**
+ * grss_feed_channel_set_copyright_take:
+ * @channel: a #GrssFeedChannel.
+ * @copyright: (transfer full): copyright of the channel.
+ *
+ * As grss_feed_channel_set_copyright(), but @channel takes ownership of
+ * @copyright.
+ */
+void
+grss_feed_channel_set_copyright_take (GrssFeedChannel *channel, gchar *copyright)
+{
+	FREE_STRING (channel->priv->copyright);
+	channel->priv->copyright = copyright;
+}
+
 /**
  * grss_feed_channel_get_copyright:
  * @channel: a #GrssFeedChannel.
@@ -809,8 +963,8 @@ grss_feed_channel_get_webmaster (GrssFeedChannel *channel)
 void
 grss_feed_channel_set_generator (GrssFeedChannel *channel, gchar *generator)
 {
-	FREE_STRING (channel->priv->generator);
-	channel->priv->generator = g_strdup (generator);
+	FREE_INTERNED (channel->priv->generator);
+	channel->priv->generator = intern_string (generator);
 }
 
 /**
@@ -940,34 +1094,122 @@ grss_feed_channel_get_update_interval (GrssFeedChannel *channel)
 	return channel->priv->update_interval;
 }
 
+/**
+ * grss_feed_channel_set_max_items:
+ * @channel: a #GrssFeedChannel.
+ * @max_items: maximum number of items to parse, or 0 for no limit.
+ *
+ * To limit the number of items parsed from the @channel: only the first
+ * @max_items found in the document (usually the most recent ones) are
+ * returned by grss_feed_channel_fetch_all() and
+ * grss_feed_channel_fetch_all_async(), and the rest of the document is not
+ * parsed. This applies to any #GrssFeedParser used with this @channel, in
+ * addition to the limit eventually set with grss_feed_parser_set_max_items().
+ */
+void
+grss_feed_channel_set_max_items (GrssFeedChannel *channel, guint max_items)
+{
+	channel->priv->max_items = max_items;
+}
+
+/**
+ * grss_feed_channel_get_max_items:
+ * @channel: a #GrssFeedChannel.
+ *
+ * Retrieves the value set with grss_feed_channel_set_max_items().
+ *
+ * Returns: maximum number of items parsed from the @channel, or 0 if there
+ * is no limit.
+ */
+guint
+grss_feed_channel_get_max_items (GrssFeedChannel *channel)
+{
+	return channel->priv->max_items;
+}
+
+/**
+ * grss_feed_channel_get_encoding:
+ * @channel: a #GrssFeedChannel.
+ *
+ * To know how the contents of the last document parsed for the @channel
+ * have been normalized to UTF-8 before the parsing. This helps to spot
+ * sources publishing broken or mislabeled documents.
+ *
+ * Returns: the #GrssFeedChannelEncoding of the last parsed document.
+ */
+GrssFeedChannelEncoding
+grss_feed_channel_get_encoding (GrssFeedChannel *channel)
+{
+	return channel->priv->encoding;
+}
+
+/**
+ * grss_feed_channel_get_charset:
+ * @channel: a #GrssFeedChannel.
+ *
+ * Retrieves the charset of the last document parsed for the @channel, as
+ * found in its byte order mark, in its XML declaration or in the HTTP
+ * headers.
+ *
+ * Returns: the name of the charset, or %NULL if none was declared and
+ * UTF-8 has been assumed.
+ */
+const gchar*
+grss_feed_channel_get_charset (GrssFeedChannel *channel)
+{
+	return channel->priv->charset;
+}
+
+/*
+ * To be called by the #GrssFeedParser, once the contents of a document have
+ * been normalized
+ */
+void
+grss_feed_channel_set_encoding (GrssFeedChannel *channel, GrssFeedChannelEncoding encoding, const gchar *charset)
+{
+	FREE_INTERNED (channel->priv->charset);
+	channel->priv->encoding = encoding;
+	channel->priv->charset = intern_string (charset);
+}
+
+/*
+ * @limit_error is set only if the document exceeds the limits of the
+ * @parser: other errors are reported by the caller
+ */
 static gboolean
-quick_and_dirty_parse (GrssFeedChannel *channel, SoupMessage *msg, GList **save_items)
+quick_and_dirty_parse (GrssFeedChannel *channel, GrssFeedParser *parser, SoupMessage *msg, GList **save_items, GError **limit_error)
 {
 	GList *items;
-	GList *iter;
-	xmlDocPtr doc;
-	GrssFeedParser *parser;
+	GError *error;
+	const gchar *content_type;
 
-	doc = content_to_xml (msg->response_body->data, msg->response_body->length);
-
-	if (doc != NULL) {
+	if (parser == NULL)
 		parser = grss_feed_parser_new ();
+	else
+		g_object_ref (parser);
 
-		if (save_items == NULL) {
-			grss_feed_parser_parse_channel (parser, channel, doc, NULL);
-		}
-		else {
-			items = grss_feed_parser_parse (parser, channel, doc, NULL);
-			*save_items = items;
-		}
+	error = NULL;
+	content_type = soup_message_headers_get_one (msg->response_headers, "Content-Type");
+	items = grss_feed_parser_parse_data_full (parser, channel, msg->response_body->data, msg->response_body->length,
+	                                          NULL, content_type, save_items != NULL, &error);
+	g_object_unref (parser);
 
-		g_object_unref (parser);
-		xmlFreeDoc (doc);
-		return TRUE;
+	if (save_items != NULL)
+		*save_items = items;
+
+	if (g_error_matches (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_LIMIT_EXCEEDED)) {
+		g_propagate_error (limit_error, error);
+		return FALSE;
 	}
-	else {
+
+	if (g_error_matches (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR)) {
+		g_error_free (error);
 		return FALSE;
 	}
+
+	/* a valid document in an unknown format is not an error */
+	g_clear_error (&error);
+	return TRUE;
 }
 
 static void
@@ -1019,7 +1261,7 @@ grss_feed_channel_fetch (GrssFeedChannel *channel, GError **error)
 	status = soup_session_send_message (session, msg);
 
 	if (status >= 200 && status <= 299) {
-		ret = quick_and_dirty_parse (channel, msg, NULL);
+		ret = quick_and_dirty_parse (channel, NULL, msg, NULL, NULL);
 		if (ret == FALSE)
 			g_set_error (error, FEED_CHANNEL_ERROR, FEED_CHANNEL_PARSE_ERROR, "Unable to parse file");
 	}
@@ -1044,7 +1286,7 @@ feed_downloaded (SoupSession *session, SoupMessage *msg, gpointer user_data) {
 	g_object_get (msg, "status-code", &status, NULL);
 
 	if (status >= 200 && status <= 299) {
-		if (quick_and_dirty_parse (channel, msg, NULL) == FALSE)
+		if (quick_and_dirty_parse (channel, NULL, msg, NULL, NULL) == FALSE)
 			g_task_return_new_error (task, FEED_CHANNEL_ERROR, FEED_CHANNEL_PARSE_ERROR,
 						 "Unable to parse feed from %s", grss_feed_channel_get_source (channel));
 		else
@@ -1147,7 +1389,7 @@ grss_feed_channel_fetch_all (GrssFeedChannel *channel, GError **error)
 	items = NULL;
 
 	if (status >= 200 && status <= 299) {
-		if (quick_and_dirty_parse (channel, msg, &items) == FALSE)
+		if (quick_and_dirty_parse (channel, NULL, msg, &items, NULL) == FALSE)
 			g_set_error (error, FEED_CHANNEL_ERROR, FEED_CHANNEL_PARSE_ERROR, "Unable to parse file");
 	}
 	else {
@@ -1174,12 +1416,62 @@ free_items_list (gpointer list)
 	g_list_free (items);
 }
 
+/*
+ * A parse spanning many iterations of the main loop may end after a new
+ * fetch has been started: the cancellable is released only if it is
+ * still the one of @task
+ */
+static void
+clear_fetch_cancel (GrssFeedChannel *channel, GTask *task)
+{
+	if (channel->priv->fetchcancel == g_task_get_cancellable (task))
+		g_clear_object (&channel->priv->fetchcancel);
+}
+
+static void
+feed_parsed_return_items (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GList *items;
+	GTask *task;
+	GError *error;
+	GrssFeedChannel *channel;
+
+	task = user_data;
+	channel = GRSS_FEED_CHANNEL (g_task_get_source_object (task));
+
+	error = NULL;
+	items = grss_feed_parser_parse_sliced_finish (GRSS_FEED_PARSER (source), res, &error);
+
+	if (error == NULL) {
+		g_task_return_pointer (task, items, free_items_list);
+	}
+	else if (g_error_matches (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_LIMIT_EXCEEDED) ||
+	         g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_task_return_error (task, error);
+	}
+	else if (g_error_matches (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR)) {
+		g_error_free (error);
+		g_task_return_new_error (task, FEED_CHANNEL_ERROR, FEED_CHANNEL_PARSE_ERROR,
+					 "Unable to parse feed from %s", grss_feed_channel_get_source (channel));
+	}
+	else {
+		/* as for the other fetching functions, a valid XML document in
+		   an unknown format is not an error */
+		g_error_free (error);
+		g_task_return_pointer (task, NULL, NULL);
+	}
+
+	clear_fetch_cancel (channel, task);
+	g_object_unref (task);
+}
+
 static void
 feed_downloaded_return_items (SoupSession *session, SoupMessage *msg, gpointer user_data)
 {
 	guint status;
-	GList *items;
 	GTask *task;
+	GBytes *contents;
+	GrssFeedParser *parser;
 	GrssFeedChannel *channel;
 
 	task = user_data;
@@ -1187,21 +1479,29 @@ feed_downloaded_return_items (SoupSession *session, SoupMessage *msg, gpointer u
 	g_object_get (msg, "status-code", &status, NULL);
 
 	if (status >= 200 && status <= 299) {
-		items = NULL;
-
-		if (quick_and_dirty_parse (channel, msg, &items) == TRUE)
-			g_task_return_pointer (task, items, free_items_list);
+		/* the document is parsed a piece at a time, not to block the main loop */
+		parser = g_task_get_task_data (task);
+		if (parser == NULL)
+			parser = grss_feed_parser_new ();
 		else
-			g_task_return_new_error (task, FEED_CHANNEL_ERROR, FEED_CHANNEL_PARSE_ERROR,
-						 "Unable to parse feed from %s", grss_feed_channel_get_source (channel));
+			g_object_ref (parser);
+
+		contents = g_bytes_new_with_free_func (msg->response_body->data, msg->response_body->length,
+		                                       g_object_unref, g_object_ref (msg));
+		grss_feed_parser_parse_sliced_async (parser, channel, contents,
+		                                     soup_message_headers_get_one (msg->response_headers, "Content-Type"),
+		                                     g_task_get_cancellable (task), feed_parsed_return_items, task);
+
+		g_bytes_unref (contents);
+		g_object_unref (parser);
 	}
 	else {
 		g_task_return_new_error (task, FEED_CHANNEL_ERROR, FEED_CHANNEL_FETCH_ERROR,
 						 "Unable to download from %s", grss_feed_channel_get_source (channel));
-	}
 
-	g_clear_object (&channel->priv->fetchcancel);
-	g_object_unref (task);
+		g_clear_object (&channel->priv->fetchcancel);
+		g_object_unref (task);
+	}
 }
 
 /**
@@ -1214,6 +1514,16 @@ feed_downloaded_return_items (SoupSession *session, SoupMessage *msg, gpointer u
  */
 void
 grss_feed_channel_fetch_all_async (GrssFeedChannel *channel, GAsyncReadyCallback callback, gpointer user_data)
+{
+	grss_feed_channel_fetch_all_with_parser_async (channel, NULL, callback, user_data);
+}
+
+/*
+ * As grss_feed_channel_fetch_all_async(), but the items are parsed with the
+ * given @parser (if not NULL) and its options
+ */
+void
+grss_feed_channel_fetch_all_with_parser_async (GrssFeedChannel *channel, GrssFeedParser *parser, GAsyncReadyCallback callback, gpointer user_data)
 {
 	GTask *task;
 	SoupMessage *msg;
@@ -1222,6 +1532,9 @@ grss_feed_channel_fetch_all_async (GrssFeedChannel *channel, GAsyncReadyCallback
 	do_prefetch (channel);
 	task = g_task_new (channel, channel->priv->fetchcancel, callback, user_data);
 
+	if (parser != NULL)
+		g_task_set_task_data (task, g_object_ref (parser), g_object_unref);
+
 	session = soup_session_async_new ();
 	init_soup_session (session, channel);
 
@@ -1252,6 +1565,192 @@ grss_feed_channel_fetch_all_finish (GrssFeedChannel *channel, GAsyncResult *res,
 	return g_task_propagate_pointer (G_TASK (res), error);
 }
 
+/*
+	Documents fetched with grss_feed_channel_fetch_foreach_async() are not
+	accumulated into the message: each chunk is passed to the stream as
+	soon as it is received, then released
+*/
+typedef struct {
+	SoupSession		*session;
+	GrssFeedParser		*parser;
+	GrssFeedParserStream	*stream;
+	GrssFeedParserForeachFunc func;
+	gpointer		func_data;
+	GError			*error;
+} StreamedFetch;
+
+static void
+free_streamed_fetch (gpointer data)
+{
+	StreamedFetch *fetch;
+
+	fetch = data;
+
+	if (fetch->stream != NULL)
+		grss_feed_parser_stream_free (fetch->stream);
+	if (fetch->error != NULL)
+		g_error_free (fetch->error);
+
+	g_object_unref (fetch->parser);
+	g_object_unref (fetch->session);
+	g_free (fetch);
+}
+
+static void
+feed_got_chunk (SoupMessage *msg, SoupBuffer *chunk, gpointer user_data)
+{
+	GTask *task;
+	StreamedFetch *fetch;
+	GrssFeedChannel *channel;
+
+	task = user_data;
+	fetch = g_task_get_task_data (task);
+
+	/* bodies of redirects and errors are not the document */
+	if (SOUP_STATUS_IS_SUCCESSFUL (msg->status_code) == FALSE)
+		return;
+
+	if (fetch->stream == NULL) {
+		channel = GRSS_FEED_CHANNEL (g_task_get_source_object (task));
+		fetch->stream = grss_feed_parser_stream_new (fetch->parser, channel,
+		                                             soup_message_headers_get_one (msg->response_headers, "Content-Type"),
+		                                             fetch->func, fetch->func_data);
+	}
+
+	if (g_cancellable_is_cancelled (g_task_get_cancellable (task)) ||
+	    grss_feed_parser_stream_push (fetch->stream, chunk->data, chunk->length, &fetch->error) == FALSE)
+		soup_session_cancel_message (fetch->session, msg, SOUP_STATUS_CANCELLED);
+}
+
+static void
+feed_streamed (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	guint status;
+	GTask *task;
+	GError *error;
+	StreamedFetch *fetch;
+	GrssFeedChannel *channel;
+
+	task = user_data;
+	fetch = g_task_get_task_data (task);
+	channel = GRSS_FEED_CHANNEL (g_task_get_source_object (task));
+	g_object_get (msg, "status-code", &status, NULL);
+
+	error = fetch->error;
+	fetch->error = NULL;
+
+	/* the message is cancelled also when the stream wants no more data */
+	if (g_task_return_error_if_cancelled (task)) {
+		g_clear_error (&error);
+	}
+	else if ((status >= 200 && status <= 299) || (status == SOUP_STATUS_CANCELLED && fetch->stream != NULL)) {
+		if (fetch->stream == NULL)
+			fetch->stream = grss_feed_parser_stream_new (fetch->parser, channel, NULL, fetch->func, fetch->func_data);
+
+		if (error == NULL)
+			grss_feed_parser_stream_finish (fetch->stream, &error);
+		else
+			grss_feed_parser_stream_free (fetch->stream);
+		fetch->stream = NULL;
+
+		if (error == NULL) {
+			g_task_return_boolean (task, TRUE);
+		}
+		else if (g_error_matches (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_LIMIT_EXCEEDED)) {
+			g_task_return_error (task, error);
+		}
+		else if (g_error_matches (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR)) {
+			g_error_free (error);
+			g_task_return_new_error (task, FEED_CHANNEL_ERROR, FEED_CHANNEL_PARSE_ERROR,
+			                         "Unable to parse feed from %s", grss_feed_channel_get_source (channel));
+		}
+		else {
+			/* a valid document in an unknown format is not an error */
+			g_error_free (error);
+			g_task_return_boolean (task, TRUE);
+		}
+	}
+	else {
+		g_clear_error (&error);
+		g_task_return_new_error (task, FEED_CHANNEL_ERROR, FEED_CHANNEL_FETCH_ERROR,
+		                         "Unable to download from %s", grss_feed_channel_get_source (channel));
+	}
+
+	clear_fetch_cancel (channel, task);
+	g_object_unref (task);
+}
+
+/**
+ * grss_feed_channel_fetch_foreach_async:
+ * @channel: a #GrssFeedChannel.
+ * @parser: (allow-none): the #GrssFeedParser to use, or %NULL for a default
+ *          one.
+ * @func: function invoked for each item, until the operation is complete.
+ * @func_data: data to pass to @func.
+ * @callback: function to invoke at the end of the download.
+ * @user_data: data passed to the callback.
+ *
+ * Similar to grss_feed_channel_fetch_all_async(), but intended for very
+ * large documents: the contents are parsed while they are downloaded, with
+ * a #GrssFeedParserStream, and each item is passed to @func as soon as it
+ * has been read. The whole document is never held in memory, neither are
+ * its items: see grss_feed_parser_stream_new() about the limits which
+ * bound the memory used.
+ *
+ * The download is interrupted when @func returns %FALSE, or the maximum
+ * number of items of the @parser or the @channel has been reached.
+ */
+void
+grss_feed_channel_fetch_foreach_async (GrssFeedChannel *channel, GrssFeedParser *parser,
+                                       GrssFeedParserForeachFunc func, gpointer func_data,
+                                       GAsyncReadyCallback callback, gpointer user_data)
+{
+	GTask *task;
+	SoupMessage *msg;
+	StreamedFetch *fetch;
+
+	g_return_if_fail (func != NULL);
+
+	do_prefetch (channel);
+	task = g_task_new (channel, channel->priv->fetchcancel, callback, user_data);
+
+	fetch = g_new0 (StreamedFetch, 1);
+	fetch->parser = (parser != NULL ? g_object_ref (parser) : grss_feed_parser_new ());
+	fetch->func = func;
+	fetch->func_data = func_data;
+	g_task_set_task_data (task, fetch, free_streamed_fetch);
+
+	fetch->session = soup_session_async_new ();
+	init_soup_session (fetch->session, channel);
+
+	msg = soup_message_new ("GET", grss_feed_channel_get_source (channel));
+	init_soup_message (msg, channel);
+
+	soup_message_body_set_accumulate (msg->response_body, FALSE);
+	g_signal_connect (msg, "got-chunk", G_CALLBACK (feed_got_chunk), task);
+
+	soup_session_queue_message (fetch->session, msg, feed_streamed, task);
+}
+
+/**
+ * grss_feed_channel_fetch_foreach_finish:
+ * @channel: a #GrssFeedChannel.
+ * @res: the #GAsyncResult passed to the callback.
+ * @error: if an error occurred, %FALSE is returned and this is filled with the
+ *         message.
+ *
+ * Finalizes an asyncronous operation started with
+ * grss_feed_channel_fetch_foreach_async().
+ *
+ * Returns: %TRUE if the document has been fetched and parsed, %FALSE
+ * otherwise.
+ */
+gboolean
+grss_feed_channel_fetch_foreach_finish (GrssFeedChannel *channel, GAsyncResult *res, GError **error)
+{
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
 /**
  * grss_feed_channel_fetch_cancel:
  * @channel: a #GrssFeedChannel.
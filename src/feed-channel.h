@@ -44,6 +44,28 @@ typedef struct {
 	GObjectClass parent;
 } GrssFeedChannelClass;
 
+/**
+ * GrssFeedChannelEncoding:
+ * @GRSS_FEED_CHANNEL_ENCODING_UNKNOWN: the channel has not been parsed yet.
+ * @GRSS_FEED_CHANNEL_ENCODING_UTF8: the document was valid UTF-8.
+ * @GRSS_FEED_CHANNEL_ENCODING_TRANSCODED: the document was in another
+ * charset, and has been converted to UTF-8.
+ * @GRSS_FEED_CHANNEL_ENCODING_REPAIRED: the document contained invalid
+ * sequences or characters, which have been replaced or dropped.
+ * @GRSS_FEED_CHANNEL_ENCODING_UNSUPPORTED: the document was in a charset
+ * not known to the system, and has been left to libxml2 as it was.
+ *
+ * How the contents of the last parsed document of a #GrssFeedChannel have
+ * been brought to UTF-8, as reported by grss_feed_channel_get_encoding().
+ */
+typedef enum {
+	GRSS_FEED_CHANNEL_ENCODING_UNKNOWN,
+	GRSS_FEED_CHANNEL_ENCODING_UTF8,
+	GRSS_FEED_CHANNEL_ENCODING_TRANSCODED,
+	GRSS_FEED_CHANNEL_ENCODING_REPAIRED,
+	GRSS_FEED_CHANNEL_ENCODING_UNSUPPORTED
+} GrssFeedChannelEncoding;
+
 GType			grss_feed_channel_get_type		(void) G_GNUC_CONST;
 
 GrssFeedChannel*	grss_feed_channel_new			();
@@ -51,16 +73,21 @@ GrssFeedChannel*	grss_feed_channel_new_with_source	(gchar *source);
 GrssFeedChannel*	grss_feed_channel_new_from_xml		(xmlDocPtr doc, GError **error);
 GrssFeedChannel*	grss_feed_channel_new_from_memory	(const gchar *data, GError **error);
 GrssFeedChannel*	grss_feed_channel_new_from_file		(const gchar *path, GError **error);
+void			grss_feed_channel_new_from_file_async	(const gchar *path, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+GrssFeedChannel*	grss_feed_channel_new_from_file_finish	(GAsyncResult *res, GError **error);
 
 void			grss_feed_channel_set_format		(GrssFeedChannel *channel, gchar *format);
 const gchar*		grss_feed_channel_get_format		(GrssFeedChannel *channel);
 gboolean		grss_feed_channel_set_source		(GrssFeedChannel *channel, gchar *source);
 const gchar*		grss_feed_channel_get_source		(GrssFeedChannel *channel);
 void			grss_feed_channel_set_title		(GrssFeedChannel *channel, gchar *title);
+void			grss_feed_channel_set_title_take	(GrssFeedChannel *channel, gchar *title);
 const gchar*		grss_feed_channel_get_title		(GrssFeedChannel *channel);
 gboolean		grss_feed_channel_set_homepage		(GrssFeedChannel *channel, gchar *homepage);
+gboolean		grss_feed_channel_set_homepage_take	(GrssFeedChannel *channel, gchar *homepage);
 const gchar*		grss_feed_channel_get_homepage		(GrssFeedChannel *channel);
 void			grss_feed_channel_set_description	(GrssFeedChannel *channel, gchar *description);
+void			grss_feed_channel_set_description_take	(GrssFeedChannel *channel, gchar *description);
 const gchar*		grss_feed_channel_get_description	(GrssFeedChannel *channel);
 gboolean		grss_feed_channel_set_image		(GrssFeedChannel *channel, gchar *image);
 const gchar*		grss_feed_channel_get_image		(GrssFeedChannel *channel);
@@ -76,6 +103,7 @@ void			grss_feed_channel_set_rsscloud		(GrssFeedChannel *channel, gchar *path, g
 gboolean		grss_feed_channel_get_rsscloud		(GrssFeedChannel *channel, gchar **path, gchar **protocol);
 
 void			grss_feed_channel_set_copyright		(GrssFeedChannel *channel, gchar *copyright);
+void			grss_feed_channel_set_copyright_take	(GrssFeedChannel *channel, gchar *copyright);
 const gchar*		grss_feed_channel_get_copyright		(GrssFeedChannel *channel);
 void			grss_feed_channel_set_editor		(GrssFeedChannel *channel, GrssPerson *editor);
 GrssPerson*		grss_feed_channel_get_editor		(GrssFeedChannel *channel);
@@ -96,6 +124,11 @@ void			grss_feed_channel_set_update_time	(GrssFeedChannel *channel, time_t updat
 time_t			grss_feed_channel_get_update_time	(GrssFeedChannel *channel);
 void			grss_feed_channel_set_update_interval	(GrssFeedChannel *channel, int minutes);
 int			grss_feed_channel_get_update_interval	(GrssFeedChannel *channel);
+void			grss_feed_channel_set_max_items		(GrssFeedChannel *channel, guint max_items);
+guint			grss_feed_channel_get_max_items		(GrssFeedChannel *channel);
+
+GrssFeedChannelEncoding	grss_feed_channel_get_encoding		(GrssFeedChannel *channel);
+const gchar*		grss_feed_channel_get_charset		(GrssFeedChannel *channel);
 
 gboolean		grss_feed_channel_fetch			(GrssFeedChannel *channel, GError **error);
 void			grss_feed_channel_fetch_async		(GrssFeedChannel *channel, GAsyncReadyCallback callback, gpointer user_data);
@@ -59,7 +59,7 @@ grss_feed_enclosure_finalize (GObject *obj)
 
 	enclosure = GRSS_FEED_ENCLOSURE (obj);
 	FREE_STRING (enclosure->priv->url);
-	FREE_STRING (enclosure->priv->type);
+	FREE_INTERNED (enclosure->priv->type);
 }
 
 static void
@@ -122,8 +122,8 @@ grss_feed_enclosure_get_url (GrssFeedEnclosure *enclosure)
 void
 grss_feed_enclosure_set_format (GrssFeedEnclosure *enclosure, gchar *type)
 {
-	FREE_STRING (enclosure->priv->type);
-	enclosure->priv->type = g_strdup (type);
+	FREE_INTERNED (enclosure->priv->type);
+	enclosure->priv->type = intern_string (type);
 }
 
 /**
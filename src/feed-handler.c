@@ -20,6 +20,7 @@
 
 #include "utils.h"
 #include "feed-handler.h"
+#include "feed-item-private.h"
 
 static void
 feed_handler_base_init (gpointer g_class)
@@ -29,16 +30,17 @@ feed_handler_base_init (gpointer g_class)
 GType
 feed_handler_get_type ()
 {
-	static GType iface_type = 0;
+	static volatile gsize iface_type = 0;
 
-	if (iface_type == 0) {
+	/* parsers may be created in many threads at the same time */
+	if (g_once_init_enter (&iface_type)) {
 		static const GTypeInfo info = {
 			sizeof (FeedHandlerInterface),
 			feed_handler_base_init,
 			NULL,
 		};
 
-		iface_type = g_type_register_static (G_TYPE_INTERFACE, "FeedHandler", &info, 0);
+		g_once_init_leave (&iface_type, g_type_register_static (G_TYPE_INTERFACE, "FeedHandler", &info, 0));
 	}
 
 	return iface_type;
@@ -53,20 +55,245 @@ feed_handler_set_ns_handler (FeedHandler *self, NSHandler *handler)
 	return FEED_HANDLER_GET_INTERFACE (self)->set_ns_handler (self, handler);
 }
 
-gboolean
-feed_handler_check_format (FeedHandler *self, xmlDocPtr doc, xmlNodePtr cur)
+const gchar**
+feed_handler_get_roots (FeedHandler *self)
 {
 	if (IS_FEED_HANDLER (self) == FALSE)
-		return FALSE;
+		return NULL;
 
-	return FEED_HANDLER_GET_INTERFACE (self)->check_format (self, doc, cur);
+	return FEED_HANDLER_GET_INTERFACE (self)->get_roots (self);
 }
 
 GList*
-feed_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, GError **error)
+feed_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, FeedParseContext *context, GError **error)
 {
 	if (IS_FEED_HANDLER (self) == FALSE)
 		return FALSE;
 
-	return FEED_HANDLER_GET_INTERFACE (self)->parse (self, feed, doc, do_items, error);
+	return FEED_HANDLER_GET_INTERFACE (self)->parse (self, feed, doc, do_items, context, error);
+}
+
+/*
+ * Handlers create their items here, to have them configured as required by
+ * the options of the parser. @cur is the node of the item, or NULL for
+ * documents not parsed by libxml2
+ */
+GrssFeedItem*
+feed_parse_context_new_item (FeedParseContext *context, GrssFeedChannel *feed, xmlNodePtr cur)
+{
+	gchar *namespaces;
+	GrssFeedItem *item;
+
+	/* when building records, the same item is filled again and again */
+	if (context->scratch != NULL) {
+		item = context->scratch;
+		context->scratch = NULL;
+		return item;
+	}
+
+	item = grss_feed_item_new (feed);
+
+	if (context->records == NULL) {
+		if (context->lazy_content && context->namespaces_cached == FALSE && cur != NULL) {
+			namespaces = xhtml_root_namespaces (cur->doc);
+			context->namespaces = intern_string (namespaces);
+			context->namespaces_cached = TRUE;
+			g_free (namespaces);
+		}
+
+		grss_feed_item_set_lazy (item, context->lazy_content, context->namespaces);
+	}
+
+	return item;
+}
+
+/*
+ * To be called before parsing the node of an item: returns TRUE if the ID
+ * found by @peek is already known to the caller of the parser, and the item
+ * can be skipped
+ */
+gboolean
+feed_parse_context_skip_node (FeedParseContext *context, FeedHandler *self, GrssFeedChannel *feed, xmlNodePtr cur, FeedItemIdPeek peek)
+{
+	gchar *id;
+	gboolean ret;
+
+	if (context->seen_func == NULL)
+		return FALSE;
+
+	id = peek (self, context, cur);
+	if (id == NULL)
+		return FALSE;
+
+	ret = feed_parse_context_skip_id (context, feed, id);
+	xmlFree (id);
+	return ret;
+}
+
+/*
+ * As feed_parse_context_skip_node(), for handlers extracting the ID of the
+ * item by themselves. @id is normalized in place
+ */
+gboolean
+feed_parse_context_skip_id (FeedParseContext *context, GrssFeedChannel *feed, gchar *id)
+{
+	gchar *iter;
+
+	if (context->seen_func == NULL)
+		return FALSE;
+
+	/* the same normalization of grss_feed_item_set_id() */
+	for (iter = id; *iter != '\0'; iter++)
+		if (*iter == ' ')
+			*iter = '_';
+
+	return context->seen_func (feed, id, context->seen_data);
+}
+
+/*
+ * Returns TRUE if the item is already known to the caller of the parser, and
+ * has to be dropped. This catches the items whose ID has not been found by
+ * feed_parse_context_skip_node()
+ */
+static gboolean
+feed_parse_context_skip_item (FeedParseContext *context, GrssFeedChannel *feed, GrssFeedItem *item)
+{
+	const gchar *id;
+
+	if (context->seen_func == NULL)
+		return FALSE;
+
+	id = grss_feed_item_get_id (item);
+	if (id == NULL)
+		return FALSE;
+
+	return context->seen_func (feed, id, context->seen_data);
+}
+
+/*
+ * To be called after parsing an item: returns TRUE if @item has to be added
+ * to the list returned by the handler. Otherwise the item has been dropped,
+ * converted to a record or passed to the foreach function
+ */
+gboolean
+feed_parse_context_collect_item (FeedParseContext *context, GrssFeedChannel *feed, GrssFeedItem *item, time_t now)
+{
+	if (feed_parse_context_skip_item (context, feed, item)) {
+		g_object_unref (item);
+		return FALSE;
+	}
+
+	if (grss_feed_item_get_publish_time (item) == 0)
+		grss_feed_item_set_publish_time (item, now);
+
+	context->num_items++;
+
+	if (context->foreach_func != NULL) {
+		if (context->foreach_func (feed, item, context->foreach_data) == FALSE)
+			context->stopped = TRUE;
+
+		g_object_unref (item);
+		return FALSE;
+	}
+
+	if (context->records == NULL)
+		return TRUE;
+
+	g_ptr_array_add (context->records, grss_feed_item_steal_record (item));
+
+	if (context->scratch == NULL)
+		context->scratch = item;
+	else
+		g_object_unref (item);
+
+	return FALSE;
+}
+
+/*
+ * TRUE if the maximum number of items has been reached, or the foreach
+ * function asked to stop, and no other has to be parsed. Also TRUE when the
+ * time allowed for parsing is over, in which case timed_out is set
+ */
+gboolean
+feed_parse_context_is_full (FeedParseContext *context)
+{
+	if (context->deadline != 0 && g_get_monotonic_time () > context->deadline)
+		context->timed_out = TRUE;
+
+	return (context->timed_out || context->stopped ||
+	        (context->max_items != 0 && context->num_items >= context->max_items));
+}
+
+/*
+ * TRUE if the elements providing @field have not to be parsed. A @field of
+ * 0 is for elements which are always parsed
+ */
+gboolean
+feed_parse_context_skip_field (FeedParseContext *context, GrssFeedParserFields field)
+{
+	return (field != 0 && (context->fields & field) == 0);
+}
+
+/*
+ * Returns the node where the previous slice of the parsing stopped, or NULL
+ * if the parsing has to begin from the start of the document
+ */
+xmlNodePtr
+feed_parse_context_resume (FeedParseContext *context)
+{
+	context->resumed_at = context->resume;
+	context->resume = NULL;
+	return context->resumed_at;
+}
+
+/*
+ * To be called by handlers before each node at the top level of the
+ * document: returns TRUE if the current slice of the parsing is over, and
+ * the handler has to return leaving @cur to the next one. At least one node
+ * is parsed in each slice
+ */
+gboolean
+feed_parse_context_yield (FeedParseContext *context, xmlNodePtr cur)
+{
+	if (context->slice_end == 0 || cur == context->resumed_at)
+		return FALSE;
+
+	if (g_get_monotonic_time () < context->slice_end)
+		return FALSE;
+
+	context->resume = cur;
+	return TRUE;
+}
+
+/*
+ * Returns the base URL to resolve relative references found in @cur,
+ * already escaped to be used with resolve_url(), or NULL. All the elements
+ * sharing the same nearest xml:base (usually, all the ones in the document)
+ * share the same base, which is computed once
+ */
+const gchar*
+feed_parse_context_get_base (FeedParseContext *context, xmlNodePtr cur)
+{
+	xmlChar *base;
+	xmlNodePtr scope;
+
+	for (scope = cur; scope != NULL && scope->type == XML_ELEMENT_NODE; scope = scope->parent)
+		if (xmlHasNsProp (scope, BAD_CAST"base", XML_XML_NAMESPACE) != NULL)
+			break;
+
+	if (scope != NULL && scope->type != XML_ELEMENT_NODE)
+		scope = NULL;
+
+	if (context->base_cached && context->base_scope == scope)
+		return context->base_url;
+
+	g_free (context->base_url);
+
+	base = xmlNodeGetBase (cur->doc, cur);
+	context->base_url = (base != NULL ? (gchar*) xmlURIEscape (base) : NULL);
+	xmlFree (base);
+
+	context->base_scope = scope;
+	context->base_cached = TRUE;
+	return context->base_url;
 }
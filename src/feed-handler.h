@@ -23,6 +23,7 @@
 
 #include "libgrss.h"
 #include "ns-handler.h"
+#include "feed-item-private.h"
 
 #define FEED_HANDLER_TYPE			(feed_handler_get_type ())
 #define FEED_HANDLER(obj)			(G_TYPE_CHECK_INSTANCE_CAST ((obj), FEED_HANDLER_TYPE, FeedHandler))
@@ -32,18 +33,102 @@
 typedef struct _FeedHandler		FeedHandler;
 typedef struct _FeedHandlerInterface	FeedHandlerInterface;
 
+/*
+ * State of a single parsing, shared by the #GrssFeedParser with the handler
+ * in charge of the document
+ */
+typedef struct {
+	gboolean		lazy_content;
+	GrssFeedParserFields	fields;
+
+	/* interned namespaces of the root of the document, shared by the
+	   lazy descriptions of all items */
+	gboolean		namespaces_cached;
+	gchar			*namespaces;
+	guint			max_items;
+	guint			num_items;
+
+	/* monotonic time by which items have to be built, or 0 */
+	gint64			deadline;
+	gboolean		timed_out;
+
+	/* for parsings split in slices: end of the current one, and where
+	   the handler stopped */
+	gint64			slice_end;
+	xmlNodePtr		resume;
+	xmlNodePtr		resumed_at;
+
+	/* as resume, for handlers not working on a tree: offset of the
+	   next item in the contents, or 0 */
+	gsize			resume_offset;
+
+	/* limits of the parser, enforced by the handlers not working on a
+	   tree read by libxml2; the nodes and the text met in the previous
+	   slices */
+	const GrssFeedParserLimits *limits;
+	guint			nodes;
+	gsize			text_size;
+
+	/* the contents have already been checked to be valid UTF-8 */
+	gboolean		valid_utf8;
+
+	/* set by handlers returning the items from the last in the document */
+	gboolean		reversed;
+
+	GrssFeedParserSeenFunc	seen_func;
+	gpointer		seen_data;
+
+	NSHandlerCache		ns_cache;
+
+	/* escaped base URL of the elements within base_scope, as returned
+	   by feed_parse_context_get_base() */
+	gboolean		base_cached;
+	xmlNodePtr		base_scope;
+	gchar			*base_url;
+
+	/* if not NULL, items are converted to records and appended here */
+	GPtrArray		*records;
+	GrssFeedItem		*scratch;
+
+	/* if not NULL, items are passed here one by one */
+	GrssFeedParserForeachFunc foreach_func;
+	gpointer		foreach_data;
+	gboolean		stopped;
+} FeedParseContext;
+
+/*
+ * Quickly extracts the ID of the item described by the node, or NULL if it
+ * cannot be guessed without parsing the whole item
+ */
+typedef gchar* (*FeedItemIdPeek) (FeedHandler *self, FeedParseContext *context, xmlNodePtr cur);
+
+/*
+ * get_roots() returns the names of the root elements of the documents the
+ * handler accepts, NULL terminated; each may be followed by "|" and the
+ * namespace the element is required to have
+ */
 struct _FeedHandlerInterface {
 	GTypeInterface parent_iface;
 
 	void (*set_ns_handler) (FeedHandler *self, NSHandler *handler);
-	gboolean (*check_format) (FeedHandler *self, xmlDocPtr doc, xmlNodePtr cur);
-	GList* (*parse) (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, GError **error);
+	const gchar** (*get_roots) (FeedHandler *self);
+	GList* (*parse) (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, FeedParseContext *context, GError **error);
 };
 
 GType		feed_handler_get_type		();
 
 void		feed_handler_set_ns_handler	(FeedHandler *self, NSHandler *handler);
-gboolean	feed_handler_check_format	(FeedHandler *self, xmlDocPtr doc, xmlNodePtr cur);
-GList*		feed_handler_parse		(FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, GError **error);
+const gchar**	feed_handler_get_roots		(FeedHandler *self);
+GList*		feed_handler_parse		(FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, FeedParseContext *context, GError **error);
+
+GrssFeedItem*	feed_parse_context_new_item	(FeedParseContext *context, GrssFeedChannel *feed, xmlNodePtr cur);
+gboolean	feed_parse_context_skip_node	(FeedParseContext *context, FeedHandler *self, GrssFeedChannel *feed, xmlNodePtr cur, FeedItemIdPeek peek);
+gboolean	feed_parse_context_skip_id	(FeedParseContext *context, GrssFeedChannel *feed, gchar *id);
+gboolean	feed_parse_context_collect_item	(FeedParseContext *context, GrssFeedChannel *feed, GrssFeedItem *item, time_t now);
+gboolean	feed_parse_context_is_full	(FeedParseContext *context);
+gboolean	feed_parse_context_skip_field	(FeedParseContext *context, GrssFeedParserFields field);
+xmlNodePtr	feed_parse_context_resume	(FeedParseContext *context);
+gboolean	feed_parse_context_yield	(FeedParseContext *context, xmlNodePtr cur);
+const gchar*	feed_parse_context_get_base	(FeedParseContext *context, xmlNodePtr cur);
 
 #endif /* __FEED_HANDLER_H__ */
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2009-2015, Roberto Guido <rguido@src.gnome.org>
+ *                          Michele Tameni <michele@amdplanet.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __FEED_ITEM_PRIVATE_H__
+#define __FEED_ITEM_PRIVATE_H__
+
+void		grss_feed_item_set_lazy				(GrssFeedItem *item, gboolean lazy, gchar *namespaces);
+GrssFeedItemRecord*	grss_feed_item_steal_record		(GrssFeedItem *item);
+void		grss_feed_item_set_description_from_node	(GrssFeedItem *item, xmlNodePtr cur, const gchar *default_base);
+gboolean	grss_feed_item_has_description			(GrssFeedItem *item);
+
+#endif
@@ -21,6 +21,7 @@
 
 #include "utils.h"
 #include "feed-item.h"
+#include "feed-item-private.h"
 #include "feed-channel.h"
 
 #define FEED_ITEM_GET_PRIVATE(obj)     (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GRSS_FEED_ITEM_TYPE, GrssFeedItemPrivate))
@@ -61,9 +62,17 @@ struct _GrssFeedItemPrivate {
 	time_t		pub_time;
 
 	GList		*enclosures;
+
+	/* escaped HTML of the description, converted only when requested,
+	   and the interned strings to place in the wrapping div */
+	gboolean	lazy;
+	gchar		*description_html;
+	gchar		*description_ns;
+	gchar		*description_base;
 };
 
 G_DEFINE_TYPE (GrssFeedItem, grss_feed_item, G_TYPE_OBJECT);
+G_DEFINE_BOXED_TYPE (GrssFeedItemRecord, grss_feed_item_record, grss_feed_item_record_copy, grss_feed_item_record_free)
 
 static void
 grss_feed_item_finalize (GObject *obj)
@@ -75,6 +84,9 @@ grss_feed_item_finalize (GObject *obj)
 	FREE_STRING (item->priv->id);
 	FREE_STRING (item->priv->title);
 	FREE_STRING (item->priv->description);
+	FREE_STRING (item->priv->description_html);
+	FREE_INTERNED (item->priv->description_ns);
+	FREE_INTERNED (item->priv->description_base);
 	FREE_STRING (item->priv->source);
 	FREE_STRING (item->priv->real_source_url);
 	FREE_STRING (item->priv->real_source_title);
@@ -92,7 +104,7 @@ grss_feed_item_finalize (GObject *obj)
 
 	if (item->priv->categories != NULL) {
 		for (iter = item->priv->categories; iter; iter = g_list_next (iter))
-			g_free (iter->data);
+			release_string (iter->data);
 		g_list_free (item->priv->categories);
 	}
 
@@ -153,6 +165,22 @@ grss_feed_item_get_parent (GrssFeedItem *item)
 	return item->priv->parent;
 }
 
+/*
+ * All blanks from the id are stripped and replaced by underscores
+ */
+static void
+normalize_id (GrssFeedItem *item)
+{
+	gchar *iter;
+
+	if (item->priv->id == NULL)
+		return;
+
+	for (iter = item->priv->id; *iter != '\0'; iter++)
+		if (*iter == ' ')
+			*iter = '_';
+}
+
 /**
  * grss_feed_item_set_id:
  * @item: a #GrssFeedItem.
@@ -164,18 +192,25 @@ grss_feed_item_get_parent (GrssFeedItem *item)
 void
 grss_feed_item_set_id (GrssFeedItem *item, gchar *id)
 {
-	gchar *iter;
-
 	FREE_STRING (item->priv->id);
 	item->priv->id = g_strdup (id);
+	normalize_id (item);
+}
 
-	/*
-		All blanks from the id are stripped and replaced by underscores
-	*/
-
-	for (iter = item->priv->id; *iter != '\0'; iter++)
-		if (*iter == ' ')
-			*iter = '_';
+/**
+ * grss_feed_item_set_id_take:
+ * @item: a #GrssFeedItem.
+ * @id: (transfer full): the new ID to set.
+ *
+ * As grss_feed_item_set_id(), but @id is not copied: @item takes ownership
+ * of the string, which has to be allocated with g_malloc().
+ */
+void
+grss_feed_item_set_id_take (GrssFeedItem *item, gchar *id)
+{
+	FREE_STRING (item->priv->id);
+	item->priv->id = id;
+	normalize_id (item);
 }
 
 /**
@@ -212,6 +247,20 @@ grss_feed_item_set_title (GrssFeedItem *item, gchar *title)
 	item->priv->title = g_strdup (title);
 }
 
+/**
+ * grss_feed_item_set_title_take:
+ * @item: a #GrssFeedItem.
+ * @title: (transfer full): title of the item.
+ *
+ * As grss_feed_item_set_title(), but @item takes ownership of @title.
+ */
+void
+grss_feed_item_set_title_take (GrssFeedItem *item, gchar *title)
+{
+	FREE_STRING (item->priv->title);
+	item->priv->title = title;
+}
+
 /**
  * grss_feed_item_get_title:
  * @item: a #GrssFeedItem.
@@ -236,24 +285,102 @@ grss_feed_item_get_title (GrssFeedItem *item)
 void
 grss_feed_item_set_description (GrssFeedItem *item, gchar *description)
 {
+	FREE_STRING (item->priv->description_html);
+	FREE_INTERNED (item->priv->description_base);
 	FREE_STRING (item->priv->description);
 	item->priv->description = g_strdup (description);
 }
 
+/**
+ * grss_feed_item_set_description_take:
+ * @item: a #GrssFeedItem.
+ * @description: (transfer full): content of the item.
+ *
+ * As grss_feed_item_set_description(), but @item takes ownership of
+ * @description.
+ */
+void
+grss_feed_item_set_description_take (GrssFeedItem *item, gchar *description)
+{
+	FREE_STRING (item->priv->description_html);
+	FREE_INTERNED (item->priv->description_base);
+	FREE_STRING (item->priv->description);
+	item->priv->description = description;
+}
+
 /**
  * grss_feed_item_get_description:
  * @item: a #GrssFeedItem.
  *
  * Retrieves the description of the @item.
  *
+ * If the item has been parsed by a #GrssFeedParser with lazy contents (see
+ * grss_feed_parser_set_lazy_content()), the description is converted to
+ * XHTML at the first call of this function. The conversion happens once, even
+ * when many threads read the same item at the same time; as for the other
+ * fields, changing the description while others read it is not safe.
+ *
  * Returns: description of @item.
  */
 const gchar*
 grss_feed_item_get_description (GrssFeedItem *item)
 {
+	static GMutex lazy_lock;
+	gchar *html;
+
+	if (g_atomic_pointer_get (&item->priv->description_html) != NULL) {
+		g_mutex_lock (&lazy_lock);
+
+		html = item->priv->description_html;
+		if (html != NULL) {
+			item->priv->description = xhtml_render_lazy (item->priv->description_ns, item->priv->description_base, html);
+			FREE_INTERNED (item->priv->description_base);
+			g_atomic_pointer_set (&item->priv->description_html, NULL);
+			g_free (html);
+		}
+
+		g_mutex_unlock (&lazy_lock);
+	}
+
 	return (const gchar*) item->priv->description;
 }
 
+void
+grss_feed_item_set_lazy (GrssFeedItem *item, gboolean lazy, gchar *namespaces)
+{
+	item->priv->lazy = lazy;
+
+	FREE_INTERNED (item->priv->description_ns);
+	if (lazy)
+		item->priv->description_ns = ref_string (namespaces);
+}
+
+/*
+ * Sets the description from the escaped HTML contained by @cur. For lazy
+ * items just the raw HTML and its base are saved, to be converted by
+ * grss_feed_item_get_description() only if someone asks for it
+ */
+void
+grss_feed_item_set_description_from_node (GrssFeedItem *item, xmlNodePtr cur, const gchar *default_base)
+{
+	grss_feed_item_set_description (item, NULL);
+
+	if (item->priv->lazy)
+		item->priv->description_html = (gchar*) xmlNodeListGetString (cur->doc, cur->xmlChildrenNode, 1);
+
+	/* empty descriptions have nothing to convert */
+	if (item->priv->description_html == NULL)
+		item->priv->description = xhtml_extract (cur, 0, default_base);
+	else
+		item->priv->description_base = xhtml_lazy_base (cur, default_base);
+}
+
+gboolean
+grss_feed_item_has_description (GrssFeedItem *item)
+{
+	return (item->priv->description != NULL || item->priv->description_html != NULL);
+}
+
 /**
  * grss_feed_item_add_category:
  * @item: a #GrssFeedItem.
@@ -267,7 +394,7 @@ grss_feed_item_add_category (GrssFeedItem *item, gchar *category)
 {
 	gchar *cat;
 
-	cat = g_strdup (category);
+	cat = intern_string (category);
 
 	if (item->priv->categories == NULL)
 		item->priv->categories = g_list_prepend (item->priv->categories, cat);
@@ -313,6 +440,31 @@ grss_feed_item_set_source (GrssFeedItem *item, gchar *source)
 	}
 }
 
+/**
+ * grss_feed_item_set_source_take:
+ * @item: a #GrssFeedItem.
+ * @source: (transfer full): URL of the item.
+ *
+ * As grss_feed_item_set_source(), but @item takes ownership of @source. If
+ * @source is not a valid URL it is freed.
+ *
+ * Returns: %TRUE if @source is a valid URL, %FALSE otherwise
+ */
+gboolean
+grss_feed_item_set_source_take (GrssFeedItem *item, gchar *source)
+{
+	FREE_STRING (item->priv->source);
+
+	if (test_url ((const gchar*) source) == TRUE) {
+		item->priv->source = source;
+		return TRUE;
+	}
+	else {
+		g_free (source);
+		return FALSE;
+	}
+}
+
 /**
  * grss_feed_item_get_source:
  * @item: a #GrssFeedItem.
@@ -413,6 +565,21 @@ grss_feed_item_set_copyright (GrssFeedItem *item, gchar *copyright)
 	item->priv->copyright = g_strdup (copyright);
 }
 
+/**
+ * grss_feed_item_set_copyright_take:
+ * @item: a #GrssFeedItem.
+ * @copyright: (transfer full): copyright declaration for the item.
+ *
+ * As grss_feed_item_set_copyright(), but @item takes ownership of
+ * @copyright.
+ */
+void
+grss_feed_item_set_copyright_take (GrssFeedItem *item, gchar *copyright)
+{
+	FREE_STRING (item->priv->copyright);
+	item->priv->copyright = copyright;
+}
+
 /**
  * grss_feed_item_get_copyright:
  * @item: a #GrssFeedItem.
@@ -516,6 +683,31 @@ grss_feed_item_set_comments_url (GrssFeedItem *item, gchar *url)
 	}
 }
 
+/**
+ * grss_feed_item_set_comments_url_take:
+ * @item: a #GrssFeedItem.
+ * @url: (transfer full): URL where to retrieve comments to the item.
+ *
+ * As grss_feed_item_set_comments_url(), but @item takes ownership of @url.
+ * If @url is not a valid URL it is freed.
+ *
+ * Returns: %TRUE if @url is a valid URL, %FALSE otherwise
+ */
+gboolean
+grss_feed_item_set_comments_url_take (GrssFeedItem *item, gchar *url)
+{
+	FREE_STRING (item->priv->comments_url);
+
+	if (test_url ((const gchar*) url) == TRUE) {
+		item->priv->comments_url = url;
+		return TRUE;
+	}
+	else {
+		g_free (url);
+		return FALSE;
+	}
+}
+
 /**
  * grss_feed_item_get_comments_url:
  * @item: a #GrssFeedItem.
@@ -641,3 +833,215 @@ grss_feed_item_get_enclosures (GrssFeedItem *item)
 {
 	return item->priv->enclosures;
 }
+
+/*
+ * Records are allocated in a single block, together with the arrays of
+ * categories, contributors and enclosures
+ */
+static GrssFeedItemRecord*
+record_alloc (guint categories, guint contributors, guint enclosures)
+{
+	gpointer *tail;
+	GrssFeedItemRecord *record;
+
+	record = g_malloc0 (sizeof (GrssFeedItemRecord) + (categories + contributors + enclosures + 3) * sizeof (gpointer));
+	tail = (gpointer*) (record + 1);
+
+	record->categories = (gchar**) tail;
+	tail += categories + 1;
+	record->contributors = (GrssPerson**) tail;
+	tail += contributors + 1;
+	record->enclosures = (GrssFeedEnclosure**) tail;
+
+	return record;
+}
+
+static gchar*
+steal_item_string (gchar **field)
+{
+	gchar *ret;
+
+	ret = *field;
+	*field = NULL;
+	return ret;
+}
+
+/*
+ * Moves all the contents of @item into a new #GrssFeedItemRecord, leaving
+ * @item empty and ready to be filled again by the parser
+ */
+GrssFeedItemRecord*
+grss_feed_item_steal_record (GrssFeedItem *item)
+{
+	int i;
+	GList *iter;
+	GrssFeedItemRecord *record;
+
+	/* lazy descriptions are converted now, records have no lazy state */
+	grss_feed_item_get_description (item);
+
+	record = record_alloc (g_list_length (item->priv->categories),
+	                       g_list_length (item->priv->contributors),
+	                       g_list_length (item->priv->enclosures));
+
+	record->id = steal_item_string (&item->priv->id);
+	record->title = steal_item_string (&item->priv->title);
+	record->description = steal_item_string (&item->priv->description);
+	record->source = steal_item_string (&item->priv->source);
+	record->real_source_url = steal_item_string (&item->priv->real_source_url);
+	record->real_source_title = steal_item_string (&item->priv->real_source_title);
+	record->related = steal_item_string (&item->priv->related);
+	record->copyright = steal_item_string (&item->priv->copyright);
+	record->comments_url = steal_item_string (&item->priv->comments_url);
+
+	record->author = item->priv->author;
+	item->priv->author = NULL;
+
+	for (i = 0, iter = item->priv->categories; iter; iter = iter->next, i++)
+		record->categories [i] = iter->data;
+	g_list_free (item->priv->categories);
+	item->priv->categories = NULL;
+
+	for (i = 0, iter = item->priv->contributors; iter; iter = iter->next, i++)
+		record->contributors [i] = iter->data;
+	g_list_free (item->priv->contributors);
+	item->priv->contributors = NULL;
+
+	for (i = 0, iter = item->priv->enclosures; iter; iter = iter->next, i++)
+		record->enclosures [i] = iter->data;
+	g_list_free (item->priv->enclosures);
+	item->priv->enclosures = NULL;
+
+	record->has_geo = item->priv->geo.has;
+	record->latitude = item->priv->geo.lat;
+	record->longitude = item->priv->geo.lon;
+	memset (&item->priv->geo, 0, sizeof (GeoInfo));
+
+	record->publish_time = item->priv->pub_time;
+	item->priv->pub_time = 0;
+
+	return record;
+}
+
+/**
+ * grss_feed_item_record_copy:
+ * @record: a #GrssFeedItemRecord.
+ *
+ * Duplicates a #GrssFeedItemRecord.
+ *
+ * Returns: (transfer full): a new #GrssFeedItemRecord, to be freed with
+ * grss_feed_item_record_free().
+ */
+GrssFeedItemRecord*
+grss_feed_item_record_copy (GrssFeedItemRecord *record)
+{
+	int i;
+	GrssFeedItemRecord *ret;
+
+	ret = record_alloc (g_strv_length (record->categories),
+	                    g_strv_length ((gchar**) record->contributors),
+	                    g_strv_length ((gchar**) record->enclosures));
+
+	ret->id = g_strdup (record->id);
+	ret->title = g_strdup (record->title);
+	ret->description = g_strdup (record->description);
+	ret->source = g_strdup (record->source);
+	ret->real_source_url = g_strdup (record->real_source_url);
+	ret->real_source_title = g_strdup (record->real_source_title);
+	ret->related = g_strdup (record->related);
+	ret->copyright = g_strdup (record->copyright);
+	ret->comments_url = g_strdup (record->comments_url);
+
+	if (record->author != NULL)
+		ret->author = grss_person_ref (record->author);
+
+	for (i = 0; record->categories [i] != NULL; i++)
+		ret->categories [i] = intern_string (record->categories [i]);
+	for (i = 0; record->contributors [i] != NULL; i++)
+		ret->contributors [i] = grss_person_ref (record->contributors [i]);
+	for (i = 0; record->enclosures [i] != NULL; i++)
+		ret->enclosures [i] = g_object_ref (record->enclosures [i]);
+
+	ret->has_geo = record->has_geo;
+	ret->latitude = record->latitude;
+	ret->longitude = record->longitude;
+	ret->publish_time = record->publish_time;
+
+	return ret;
+}
+
+/**
+ * grss_feed_item_record_free:
+ * @record: a #GrssFeedItemRecord.
+ *
+ * Frees a #GrssFeedItemRecord and all its contents.
+ */
+void
+grss_feed_item_record_free (GrssFeedItemRecord *record)
+{
+	int i;
+
+	g_free (record->id);
+	g_free (record->title);
+	g_free (record->description);
+	g_free (record->source);
+	g_free (record->real_source_url);
+	g_free (record->real_source_title);
+	g_free (record->related);
+	g_free (record->copyright);
+	g_free (record->comments_url);
+
+	if (record->author != NULL)
+		grss_person_unref (record->author);
+
+	for (i = 0; record->categories [i] != NULL; i++)
+		release_string (record->categories [i]);
+	for (i = 0; record->contributors [i] != NULL; i++)
+		grss_person_unref (record->contributors [i]);
+	for (i = 0; record->enclosures [i] != NULL; i++)
+		g_object_unref (record->enclosures [i]);
+
+	g_free (record);
+}
+
+/**
+ * grss_feed_item_record_to_item:
+ * @record: a #GrssFeedItemRecord.
+ * @parent: the feed from which the item comes.
+ *
+ * Builds a #GrssFeedItem with the same contents of @record.
+ *
+ * Returns: (transfer full): a new #GrssFeedItem.
+ */
+GrssFeedItem*
+grss_feed_item_record_to_item (GrssFeedItemRecord *record, GrssFeedChannel *parent)
+{
+	int i;
+	GrssFeedItem *item;
+
+	item = grss_feed_item_new (parent);
+
+	if (record->id != NULL)
+		grss_feed_item_set_id (item, record->id);
+	grss_feed_item_set_title (item, record->title);
+	grss_feed_item_set_description (item, record->description);
+	grss_feed_item_set_source (item, record->source);
+	grss_feed_item_set_real_source (item, record->real_source_url, record->real_source_title);
+	grss_feed_item_set_related (item, record->related);
+	grss_feed_item_set_copyright (item, record->copyright);
+	grss_feed_item_set_comments_url (item, record->comments_url);
+	grss_feed_item_set_author (item, record->author);
+
+	for (i = 0; record->categories [i] != NULL; i++)
+		grss_feed_item_add_category (item, record->categories [i]);
+	for (i = 0; record->contributors [i] != NULL; i++)
+		grss_feed_item_add_contributor (item, record->contributors [i]);
+	for (i = 0; record->enclosures [i] != NULL; i++)
+		grss_feed_item_add_enclosure (item, g_object_ref (record->enclosures [i]));
+
+	if (record->has_geo)
+		grss_feed_item_set_geo_point (item, record->latitude, record->longitude);
+	grss_feed_item_set_publish_time (item, record->publish_time);
+
+	return item;
+}
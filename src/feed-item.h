@@ -44,6 +44,53 @@ typedef struct {
 	GObjectClass parent;
 } GrssFeedItemClass;
 
+/**
+ * GrssFeedItemRecord:
+ * @id: ID of the item, or %NULL.
+ * @title: title of the item, or %NULL.
+ * @description: description of the item, or %NULL.
+ * @source: URL of the item, or %NULL.
+ * @real_source_url: URL of the real source of the item, or %NULL.
+ * @real_source_title: title of the real source of the item, or %NULL.
+ * @related: reference to a related post, or %NULL.
+ * @copyright: copyright of the item, or %NULL.
+ * @comments_url: URL where to fetch comments, or %NULL.
+ * @author: author of the item, or %NULL.
+ * @categories: %NULL-terminated array of categories.
+ * @contributors: %NULL-terminated array of #GrssPerson.
+ * @enclosures: %NULL-terminated array of #GrssFeedEnclosure.
+ * @has_geo: %TRUE if @latitude and @longitude are set.
+ * @latitude: latitude of the item.
+ * @longitude: longitude of the item.
+ * @publish_time: publish time of the item.
+ *
+ * Plain representation of a #GrssFeedItem, produced by
+ * grss_feed_parser_parse_records(). The arrays are allocated in the same
+ * block of the structure. All members are owned by the record and must not
+ * be modified or freed: use grss_feed_item_record_free() to release it.
+ */
+typedef struct {
+	gchar			*id;
+	gchar			*title;
+	gchar			*description;
+	gchar			*source;
+	gchar			*real_source_url;
+	gchar			*real_source_title;
+	gchar			*related;
+	gchar			*copyright;
+	gchar			*comments_url;
+	GrssPerson		*author;
+
+	gchar			**categories;
+	GrssPerson		**contributors;
+	GrssFeedEnclosure	**enclosures;
+
+	gboolean		has_geo;
+	double			latitude;
+	double			longitude;
+	time_t			publish_time;
+} GrssFeedItemRecord;
+
 GType			grss_feed_item_get_type		() G_GNUC_CONST;
 
 GrssFeedItem*		grss_feed_item_new		(GrssFeedChannel *parent);
@@ -51,14 +98,18 @@ GrssFeedItem*		grss_feed_item_new		(GrssFeedChannel *parent);
 GrssFeedChannel*	grss_feed_item_get_parent	(GrssFeedItem *item);
 
 void			grss_feed_item_set_id		(GrssFeedItem *item, gchar *id);
+void			grss_feed_item_set_id_take	(GrssFeedItem *item, gchar *id);
 const gchar*		grss_feed_item_get_id		(GrssFeedItem *item);
 void			grss_feed_item_set_title	(GrssFeedItem *item, gchar *title);
+void			grss_feed_item_set_title_take	(GrssFeedItem *item, gchar *title);
 const gchar*		grss_feed_item_get_title	(GrssFeedItem *item);
 void			grss_feed_item_set_description	(GrssFeedItem *item, gchar *description);
+void			grss_feed_item_set_description_take	(GrssFeedItem *item, gchar *description);
 const gchar*		grss_feed_item_get_description	(GrssFeedItem *item);
 void			grss_feed_item_add_category	(GrssFeedItem *item, gchar *category);
 const GList*		grss_feed_item_get_categories	(GrssFeedItem *item);
 gboolean		grss_feed_item_set_source	(GrssFeedItem *item, gchar *source);
+gboolean		grss_feed_item_set_source_take	(GrssFeedItem *item, gchar *source);
 const gchar*		grss_feed_item_get_source	(GrssFeedItem *item);
 gboolean		grss_feed_item_set_real_source	(GrssFeedItem *item, gchar *realsource, gchar *title);
 void			grss_feed_item_get_real_source	(GrssFeedItem *item, const gchar **realsource, const gchar **title);
@@ -66,12 +117,14 @@ void			grss_feed_item_set_related	(GrssFeedItem *item, gchar *related);
 const gchar*		grss_feed_item_get_related	(GrssFeedItem *item);
 
 void			grss_feed_item_set_copyright	(GrssFeedItem *item, gchar *copyright);
+void			grss_feed_item_set_copyright_take	(GrssFeedItem *item, gchar *copyright);
 const gchar*		grss_feed_item_get_copyright	(GrssFeedItem *item);
 void			grss_feed_item_set_author	(GrssFeedItem *item, GrssPerson *author);
 GrssPerson*		grss_feed_item_get_author	(GrssFeedItem *item);
 void			grss_feed_item_add_contributor	(GrssFeedItem *item, GrssPerson *contributor);
 const GList*		grss_feed_item_get_contributors	(GrssFeedItem *item);
 gboolean		grss_feed_item_set_comments_url	(GrssFeedItem *item, gchar *url);
+gboolean		grss_feed_item_set_comments_url_take	(GrssFeedItem *item, gchar *url);
 const gchar*		grss_feed_item_get_comments_url	(GrssFeedItem *item);
 
 void			grss_feed_item_set_geo_point	(GrssFeedItem *item, double latitude, double longitude);
@@ -82,4 +135,9 @@ time_t			grss_feed_item_get_publish_time	(GrssFeedItem *item);
 void			grss_feed_item_add_enclosure	(GrssFeedItem *item, GrssFeedEnclosure *enclosure);
 const GList*		grss_feed_item_get_enclosures	(GrssFeedItem *item);
 
+GType			grss_feed_item_record_get_type	() G_GNUC_CONST;
+GrssFeedItemRecord*	grss_feed_item_record_copy	(GrssFeedItemRecord *record);
+void			grss_feed_item_record_free	(GrssFeedItemRecord *record);
+GrssFeedItem*		grss_feed_item_record_to_item	(GrssFeedItemRecord *record, GrssFeedChannel *parent);
+
 #endif /* __FEED_ITEM_H__ */
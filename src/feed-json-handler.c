@@ -0,0 +1,1007 @@
+/*
+ * Copyright (C) 2009-2015, Roberto Guido <rguido@src.gnome.org>
+ *                          Michele Tameni <michele@amdplanet.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "feed-json-handler.h"
+#include "utils.h"
+#include "feed-channel.h"
+#include "feed-item.h"
+#include "feed-item-private.h"
+#include "feed-enclosure.h"
+
+#define JSON_FEED_VERSION_PREFIX	"https://jsonfeed.org/version/"
+
+/*
+	The tokenizer reads one token at a time straight from the contents,
+	without building a tree of the document: strings are decoded only when
+	they are required, and values not used for the feed are just skipped.
+	Separators are not strictly checked, ',' and ':' are simply ignored.
+	The limits of the parser are enforced here, as libxml2 does for XML:
+	objects and arrays count as nodes, strings and numbers as text
+*/
+
+typedef enum {
+	JSON_TOKEN_ERROR,
+	JSON_TOKEN_EOF,
+	JSON_TOKEN_OBJECT_START,
+	JSON_TOKEN_OBJECT_END,
+	JSON_TOKEN_ARRAY_START,
+	JSON_TOKEN_ARRAY_END,
+	JSON_TOKEN_STRING,
+	JSON_TOKEN_NUMBER,
+	JSON_TOKEN_LITERAL
+} JsonToken;
+
+typedef struct {
+	const gchar	*start;
+	const gchar	*pos;
+	const gchar	*end;
+	gboolean	failed;
+
+	/* the contents are known to be valid UTF-8, strings need no checks */
+	gboolean	valid_utf8;
+
+	/* last decoded key, and last decoded string or number */
+	GString		*key;
+	GString		*text;
+
+	/* NULL if there are no limits, and what has been read so far */
+	const GrssFeedParserLimits *limits;
+	guint		depth;
+	guint		nodes;
+	gsize		text_size;
+	const gchar	*exceeded;
+} JsonTokenizer;
+
+static void
+json_tokenizer_init (JsonTokenizer *tok, const gchar *data, gsize size)
+{
+	tok->start = data;
+	tok->pos = data;
+	tok->end = data + size;
+	tok->failed = FALSE;
+	tok->valid_utf8 = FALSE;
+	tok->key = g_string_sized_new (32);
+	tok->text = g_string_sized_new (256);
+	tok->limits = NULL;
+	tok->depth = 0;
+	tok->nodes = 0;
+	tok->text_size = 0;
+	tok->exceeded = NULL;
+
+	/* an UTF-8 BOM is tolerated */
+	if (size >= 3 && memcmp (data, "\xEF\xBB\xBF", 3) == 0)
+		tok->pos += 3;
+}
+
+static void
+json_tokenizer_clear (JsonTokenizer *tok)
+{
+	g_string_free (tok->key, TRUE);
+	g_string_free (tok->text, TRUE);
+}
+
+static JsonToken
+json_fail (JsonTokenizer *tok)
+{
+	tok->failed = TRUE;
+	return JSON_TOKEN_ERROR;
+}
+
+/* the parsing fails as soon as a limit is exceeded */
+static JsonToken
+json_check_limits (JsonTokenizer *tok, JsonToken token)
+{
+	if (tok->limits == NULL)
+		return token;
+
+	if (tok->limits->max_depth != 0 && tok->depth > tok->limits->max_depth)
+		tok->exceeded = "depth";
+	else if (tok->limits->max_nodes != 0 && tok->nodes > tok->limits->max_nodes)
+		tok->exceeded = "number of nodes";
+	else if (tok->limits->max_text_size != 0 && tok->text_size > tok->limits->max_text_size)
+		tok->exceeded = "text size";
+	else
+		return token;
+
+	return json_fail (tok);
+}
+
+static JsonToken
+json_open (JsonTokenizer *tok, JsonToken token)
+{
+	tok->depth++;
+	tok->nodes++;
+	return json_check_limits (tok, token);
+}
+
+static JsonToken
+json_close (JsonTokenizer *tok, JsonToken token)
+{
+	if (tok->depth > 0)
+		tok->depth--;
+	return token;
+}
+
+static gint
+json_hex4 (const gchar *p)
+{
+	gint i;
+	gint v;
+	gint ret;
+
+	ret = 0;
+
+	for (i = 0; i < 4; i++) {
+		v = g_ascii_xdigit_value (p [i]);
+		if (v < 0)
+			return -1;
+		ret = (ret << 4) | v;
+	}
+
+	return ret;
+}
+
+/*
+ * Reads a string, whose opening quote has already been consumed. If @text
+ * is NULL the string is only skipped
+ */
+static gboolean
+json_read_string (JsonTokenizer *tok, GString *text)
+{
+	gint c;
+	gint low;
+	const gchar *p;
+	const gchar *run;
+
+	if (text != NULL)
+		g_string_truncate (text, 0);
+
+	p = tok->pos;
+
+	while (TRUE) {
+		run = p;
+		while (p < tok->end && *p != '"' && *p != '\\')
+			p++;
+
+		if (text != NULL)
+			g_string_append_len (text, run, p - run);
+
+		if (p >= tok->end)
+			return FALSE;
+
+		if (*p == '"')
+			break;
+
+		if (++p >= tok->end)
+			return FALSE;
+
+		switch (*p) {
+			case '"':
+			case '\\':
+			case '/':
+				c = *p;
+				break;
+			case 'b':
+				c = '\b';
+				break;
+			case 'f':
+				c = '\f';
+				break;
+			case 'n':
+				c = '\n';
+				break;
+			case 'r':
+				c = '\r';
+				break;
+			case 't':
+				c = '\t';
+				break;
+			case 'u':
+				if (tok->end - p < 5 || (c = json_hex4 (p + 1)) < 0)
+					return FALSE;
+				p += 4;
+
+				/* surrogate pairs, anything unpaired is replaced */
+				if (c >= 0xD800 && c <= 0xDBFF && tok->end - p >= 7 && p [1] == '\\' && p [2] == 'u' &&
+				    (low = json_hex4 (p + 3)) >= 0xDC00 && low <= 0xDFFF) {
+					c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+					p += 6;
+				}
+				else if (c == 0 || (c >= 0xD800 && c <= 0xDFFF)) {
+					c = 0xFFFD;
+				}
+
+				break;
+			default:
+				return FALSE;
+		}
+
+		if (text != NULL)
+			g_string_append_unichar (text, c);
+		p++;
+	}
+
+	tok->pos = p + 1;
+	return (text == NULL || tok->valid_utf8 || g_utf8_validate (text->str, text->len, NULL));
+}
+
+static JsonToken
+json_read_literal (JsonTokenizer *tok, const gchar *literal)
+{
+	gsize len;
+
+	/* the first char has already been consumed */
+	len = strlen (literal) - 1;
+	if ((gsize) (tok->end - tok->pos) < len || memcmp (tok->pos, literal + 1, len) != 0)
+		return json_fail (tok);
+
+	tok->pos += len;
+	return JSON_TOKEN_LITERAL;
+}
+
+/*
+ * Returns the next token. Strings and numbers are decoded in @text, if not
+ * NULL
+ */
+static JsonToken
+json_next (JsonTokenizer *tok, GString *text)
+{
+	const gchar *p;
+
+	if (tok->failed)
+		return JSON_TOKEN_ERROR;
+
+	for (p = tok->pos; p < tok->end; p++)
+		if (!g_ascii_isspace (*p) && *p != ',' && *p != ':')
+			break;
+
+	if (p >= tok->end) {
+		tok->pos = p;
+		return JSON_TOKEN_EOF;
+	}
+
+	tok->pos = p + 1;
+
+	switch (*p) {
+		case '{':
+			return json_open (tok, JSON_TOKEN_OBJECT_START);
+		case '}':
+			return json_close (tok, JSON_TOKEN_OBJECT_END);
+		case '[':
+			return json_open (tok, JSON_TOKEN_ARRAY_START);
+		case ']':
+			return json_close (tok, JSON_TOKEN_ARRAY_END);
+		case '"':
+			if (json_read_string (tok, text) == FALSE)
+				return json_fail (tok);
+			tok->text_size += tok->pos - p;
+			return json_check_limits (tok, JSON_TOKEN_STRING);
+		case 't':
+			return json_read_literal (tok, "true");
+		case 'f':
+			return json_read_literal (tok, "false");
+		case 'n':
+			return json_read_literal (tok, "null");
+		default:
+			break;
+	}
+
+	if (*p != '-' && g_ascii_isdigit (*p) == FALSE)
+		return json_fail (tok);
+
+	while (tok->pos < tok->end && (g_ascii_isdigit (*tok->pos) || *tok->pos == '.' ||
+	       *tok->pos == 'e' || *tok->pos == 'E' || *tok->pos == '+' || *tok->pos == '-'))
+		tok->pos++;
+
+	if (text != NULL) {
+		g_string_truncate (text, 0);
+		g_string_append_len (text, p, tok->pos - p);
+	}
+
+	tok->text_size += tok->pos - p;
+	return json_check_limits (tok, JSON_TOKEN_NUMBER);
+}
+
+/*
+ * Skips the value beginning with @token, which has already been read
+ */
+static void
+json_skip (JsonTokenizer *tok, JsonToken token)
+{
+	guint depth;
+
+	depth = 0;
+
+	while (TRUE) {
+		switch (token) {
+			case JSON_TOKEN_OBJECT_START:
+			case JSON_TOKEN_ARRAY_START:
+				depth++;
+				break;
+			case JSON_TOKEN_OBJECT_END:
+			case JSON_TOKEN_ARRAY_END:
+				if (depth == 0) {
+					json_fail (tok);
+					return;
+				}
+				depth--;
+				break;
+			case JSON_TOKEN_ERROR:
+			case JSON_TOKEN_EOF:
+				json_fail (tok);
+				return;
+			default:
+				break;
+		}
+
+		if (depth == 0)
+			return;
+
+		token = json_next (tok, NULL);
+	}
+}
+
+static void
+json_skip_value (JsonTokenizer *tok)
+{
+	json_skip (tok, json_next (tok, NULL));
+}
+
+/*
+ * To be called within an object: returns the next key, or NULL at the end
+ * of the object. The key is valid until the next call
+ */
+static const gchar*
+json_next_key (JsonTokenizer *tok)
+{
+	JsonToken token;
+
+	token = json_next (tok, tok->key);
+	if (token == JSON_TOKEN_STRING)
+		return tok->key->str;
+
+	if (token != JSON_TOKEN_OBJECT_END)
+		json_fail (tok);
+
+	return NULL;
+}
+
+/*
+ * Returns the next value as a newly allocated string, if it is a string or
+ * a number. Anything else is skipped, and NULL is returned
+ */
+static gchar*
+json_get_string (JsonTokenizer *tok)
+{
+	JsonToken token;
+
+	token = json_next (tok, tok->text);
+
+	if (token == JSON_TOKEN_STRING || token == JSON_TOKEN_NUMBER) {
+		if (tok->text->len == 0)
+			return NULL;
+		return g_strndup (tok->text->str, tok->text->len);
+	}
+
+	json_skip (tok, token);
+	return NULL;
+}
+
+/*
+ * Enters the array, or the single object, which is the next value: returns
+ * the token of the first element, or JSON_TOKEN_ARRAY_END if there are none.
+ * The following ones are obtained with json_next_element()
+ */
+static JsonToken
+json_first_element (JsonTokenizer *tok, gboolean *single)
+{
+	JsonToken token;
+
+	token = json_next (tok, NULL);
+	*single = (token != JSON_TOKEN_ARRAY_START);
+
+	if (*single == FALSE)
+		return json_next (tok, NULL);
+
+	if (token != JSON_TOKEN_OBJECT_START) {
+		json_skip (tok, token);
+		return JSON_TOKEN_ARRAY_END;
+	}
+
+	return token;
+}
+
+static JsonToken
+json_next_element (JsonTokenizer *tok, gboolean single)
+{
+	if (single)
+		return JSON_TOKEN_ARRAY_END;
+	return json_next (tok, NULL);
+}
+
+static gboolean
+json_is_element (JsonTokenizer *tok, JsonToken token)
+{
+	if (token == JSON_TOKEN_ARRAY_END)
+		return FALSE;
+
+	if (token == JSON_TOKEN_ERROR || token == JSON_TOKEN_EOF || token == JSON_TOKEN_OBJECT_END) {
+		json_fail (tok);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+ * JSON Feed 1.0 has a single "author" object, 1.1 an array of "authors":
+ * both are handled here, the object being the first element of the array
+ */
+static GList*
+parse_authors (JsonTokenizer *tok)
+{
+	gchar *name;
+	gchar *url;
+	gboolean single;
+	const gchar *key;
+	GList *ret;
+	JsonToken token;
+
+	ret = NULL;
+
+	for (token = json_first_element (tok, &single); json_is_element (tok, token); token = json_next_element (tok, single)) {
+		if (token != JSON_TOKEN_OBJECT_START) {
+			json_skip (tok, token);
+			continue;
+		}
+
+		name = NULL;
+		url = NULL;
+
+		while ((key = json_next_key (tok)) != NULL) {
+			if (!strcmp (key, "name")) {
+				g_free (name);
+				name = json_get_string (tok);
+			}
+			else if (!strcmp (key, "url")) {
+				g_free (url);
+				url = json_get_string (tok);
+			}
+			else {
+				json_skip_value (tok);
+			}
+		}
+
+		if (name != NULL || url != NULL)
+			ret = g_list_prepend (ret, grss_person_new (name != NULL ? name : url, NULL, url));
+
+		g_free (name);
+		g_free (url);
+	}
+
+	return g_list_reverse (ret);
+}
+
+static void
+parse_tags (JsonTokenizer *tok, GrssFeedItem *item)
+{
+	JsonToken token;
+
+	token = json_next (tok, NULL);
+	if (token != JSON_TOKEN_ARRAY_START) {
+		json_skip (tok, token);
+		return;
+	}
+
+	while (json_is_element (tok, token = json_next (tok, tok->text))) {
+		if (token == JSON_TOKEN_STRING && tok->text->len != 0)
+			grss_feed_item_add_category (item, tok->text->str);
+		else
+			json_skip (tok, token);
+	}
+}
+
+static void
+parse_attachments (JsonTokenizer *tok, GrssFeedItem *item)
+{
+	gchar *url;
+	gchar *type;
+	gchar *size;
+	const gchar *key;
+	JsonToken token;
+	GrssFeedEnclosure *enclosure;
+
+	token = json_next (tok, NULL);
+	if (token != JSON_TOKEN_ARRAY_START) {
+		json_skip (tok, token);
+		return;
+	}
+
+	while (json_is_element (tok, token = json_next (tok, NULL))) {
+		if (token != JSON_TOKEN_OBJECT_START) {
+			json_skip (tok, token);
+			continue;
+		}
+
+		url = NULL;
+		type = NULL;
+		size = NULL;
+
+		while ((key = json_next_key (tok)) != NULL) {
+			if (!strcmp (key, "url")) {
+				g_free (url);
+				url = json_get_string (tok);
+			}
+			else if (!strcmp (key, "mime_type")) {
+				g_free (type);
+				type = json_get_string (tok);
+			}
+			else if (!strcmp (key, "size_in_bytes")) {
+				g_free (size);
+				size = json_get_string (tok);
+			}
+			else {
+				json_skip_value (tok);
+			}
+		}
+
+		if (url != NULL) {
+			enclosure = grss_feed_enclosure_new (url);
+			if (type != NULL)
+				grss_feed_enclosure_set_format (enclosure, type);
+			if (size != NULL)
+				grss_feed_enclosure_set_length (enclosure, g_ascii_strtoull (size, NULL, 10));
+			grss_feed_item_add_enclosure (item, enclosure);
+		}
+
+		g_free (url);
+		g_free (type);
+		g_free (size);
+	}
+}
+
+/* the last "id" wins, as in parse_item() */
+static gchar*
+peek_item_id (JsonTokenizer *tok)
+{
+	gchar *ret;
+	const gchar *key;
+	JsonTokenizer peek;
+
+	/* the position of @tok is left untouched */
+	peek = *tok;
+	ret = NULL;
+
+	while ((key = json_next_key (&peek)) != NULL) {
+		if (!strcmp (key, "id")) {
+			g_free (ret);
+			ret = json_get_string (&peek);
+		}
+		else {
+			json_skip_value (&peek);
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * Descriptions in the feed are expected to be XHTML, so plain text is
+ * escaped. "content_html" is preferred, then "content_text" and "summary"
+ */
+static void
+set_item_description (GrssFeedItem *item, gchar *html, gchar *text, gchar *summary)
+{
+	if (html != NULL)
+		grss_feed_item_set_description (item, html);
+	else if (text != NULL)
+		grss_feed_item_set_description_take (item, g_markup_escape_text (text, -1));
+	else if (summary != NULL)
+		grss_feed_item_set_description_take (item, g_markup_escape_text (summary, -1));
+}
+
+static void
+set_item_authors (GrssFeedItem *item, GList *authors)
+{
+	GList *iter;
+
+	for (iter = authors; iter; iter = g_list_next (iter)) {
+		if (iter == authors)
+			grss_feed_item_set_author (item, iter->data);
+		else
+			grss_feed_item_add_contributor (item, iter->data);
+	}
+
+	g_list_free_full (authors, (GDestroyNotify) grss_person_unref);
+}
+
+/* the opening brace of the item has already been consumed */
+static GrssFeedItem*
+parse_item (JsonTokenizer *tok, GrssFeedChannel *feed, FeedParseContext *context)
+{
+	gchar *tmp;
+	gchar *html;
+	gchar *text;
+	gchar *summary;
+	gchar *modified;
+	const gchar *key;
+	GrssFeedItem *item;
+
+	html = NULL;
+	text = NULL;
+	summary = NULL;
+	modified = NULL;
+
+	item = feed_parse_context_new_item (context, feed, NULL);
+
+	while ((key = json_next_key (tok)) != NULL) {
+		if (!strcmp (key, "id")) {
+			if ((tmp = json_get_string (tok)) != NULL)
+				grss_feed_item_set_id_take (item, tmp);
+		}
+		else if (!strcmp (key, "url")) {
+			if ((tmp = json_get_string (tok)) != NULL)
+				grss_feed_item_set_source_take (item, tmp);
+		}
+		else if (!strcmp (key, "external_url")) {
+			if ((tmp = json_get_string (tok)) != NULL) {
+				grss_feed_item_set_related (item, tmp);
+				g_free (tmp);
+			}
+		}
+		else if (!strcmp (key, "title") && !feed_parse_context_skip_field (context, GRSS_FEED_PARSER_FIELD_TITLE)) {
+			if ((tmp = json_get_string (tok)) != NULL)
+				grss_feed_item_set_title_take (item, tmp);
+		}
+		else if (!strcmp (key, "content_html") && !feed_parse_context_skip_field (context, GRSS_FEED_PARSER_FIELD_DESCRIPTION)) {
+			g_free (html);
+			html = json_get_string (tok);
+		}
+		else if (!strcmp (key, "content_text") && !feed_parse_context_skip_field (context, GRSS_FEED_PARSER_FIELD_DESCRIPTION)) {
+			g_free (text);
+			text = json_get_string (tok);
+		}
+		else if (!strcmp (key, "summary") && !feed_parse_context_skip_field (context, GRSS_FEED_PARSER_FIELD_DESCRIPTION)) {
+			g_free (summary);
+			summary = json_get_string (tok);
+		}
+		else if (!strcmp (key, "date_published")) {
+			if ((tmp = json_get_string (tok)) != NULL) {
+				grss_feed_item_set_publish_time (item, date_parse_ISO8601 (tmp));
+				g_free (tmp);
+			}
+		}
+		else if (!strcmp (key, "date_modified")) {
+			g_free (modified);
+			modified = json_get_string (tok);
+		}
+		else if ((!strcmp (key, "authors") || !strcmp (key, "author")) &&
+		         !feed_parse_context_skip_field (context, GRSS_FEED_PARSER_FIELD_AUTHORS)) {
+			set_item_authors (item, parse_authors (tok));
+		}
+		else if (!strcmp (key, "tags") && !feed_parse_context_skip_field (context, GRSS_FEED_PARSER_FIELD_CATEGORIES)) {
+			parse_tags (tok, item);
+		}
+		else if (!strcmp (key, "attachments") && !feed_parse_context_skip_field (context, GRSS_FEED_PARSER_FIELD_ENCLOSURES)) {
+			parse_attachments (tok, item);
+		}
+		else {
+			json_skip_value (tok);
+		}
+	}
+
+	set_item_description (item, html, text, summary);
+
+	/* the time of the last change is better than nothing */
+	if (grss_feed_item_get_publish_time (item) == 0 && modified != NULL)
+		grss_feed_item_set_publish_time (item, date_parse_ISO8601 (modified));
+
+	g_free (html);
+	g_free (text);
+	g_free (summary);
+	g_free (modified);
+	return item;
+}
+
+/*
+ * Parses the elements of "items" until the end of the array, or the end of
+ * the current slice of the parsing, in which case context->resume_offset is
+ * set. As for the other handlers, the returned list is reversed
+ */
+static GList*
+parse_items (JsonTokenizer *tok, GrssFeedChannel *feed, FeedParseContext *context, GList *items)
+{
+	gchar *id;
+	time_t now;
+	gboolean first;
+	const gchar *begin;
+	JsonToken token;
+	GrssFeedItem *item;
+
+	now = time (NULL);
+	first = TRUE;
+
+	while (TRUE) {
+		begin = tok->pos;
+		token = json_next (tok, NULL);
+		if (json_is_element (tok, token) == FALSE)
+			break;
+
+		/* at least one item is parsed in each slice */
+		if (first == FALSE && context->slice_end != 0 && g_get_monotonic_time () >= context->slice_end) {
+			context->resume_offset = begin - tok->start;
+			break;
+		}
+
+		first = FALSE;
+
+		if (token != JSON_TOKEN_OBJECT_START || feed_parse_context_is_full (context)) {
+			json_skip (tok, token);
+			continue;
+		}
+
+		if (context->seen_func != NULL && (id = peek_item_id (tok)) != NULL) {
+			if (feed_parse_context_skip_id (context, feed, id)) {
+				g_free (id);
+				json_skip (tok, token);
+				continue;
+			}
+
+			g_free (id);
+		}
+
+		item = parse_item (tok, feed, context);
+		if (feed_parse_context_collect_item (context, feed, item, now))
+			items = g_list_prepend (items, item);
+	}
+
+	return items;
+}
+
+static void
+parse_hubs (JsonTokenizer *tok, GrssFeedChannel *feed)
+{
+	gchar *url;
+	gchar *type;
+	const gchar *key;
+	JsonToken token;
+
+	token = json_next (tok, NULL);
+	if (token != JSON_TOKEN_ARRAY_START) {
+		json_skip (tok, token);
+		return;
+	}
+
+	while (json_is_element (tok, token = json_next (tok, NULL))) {
+		if (token != JSON_TOKEN_OBJECT_START) {
+			json_skip (tok, token);
+			continue;
+		}
+
+		url = NULL;
+		type = NULL;
+
+		while ((key = json_next_key (tok)) != NULL) {
+			if (!strcmp (key, "url")) {
+				g_free (url);
+				url = json_get_string (tok);
+			}
+			else if (!strcmp (key, "type")) {
+				g_free (type);
+				type = json_get_string (tok);
+			}
+			else {
+				json_skip_value (tok);
+			}
+		}
+
+		if (url != NULL && type != NULL && (!g_ascii_strcasecmp (type, "WebSub") || !g_ascii_strcasecmp (type, "PubSubHubbub")))
+			grss_feed_channel_set_pubsubhub (feed, url);
+
+		g_free (url);
+		g_free (type);
+	}
+}
+
+static void
+set_channel_authors (GrssFeedChannel *feed, GList *authors)
+{
+	GList *iter;
+
+	for (iter = authors; iter; iter = g_list_next (iter)) {
+		if (iter == authors)
+			grss_feed_channel_set_editor (feed, iter->data);
+		else
+			grss_feed_channel_add_contributor (feed, iter->data);
+	}
+
+	g_list_free_full (authors, (GDestroyNotify) grss_person_unref);
+}
+
+/*
+ * TRUE if @data looks like a JSON document rather than XML, which is
+ * enough to route it to this handler
+ */
+gboolean
+feed_json_handler_sniff (const gchar *data, gsize size)
+{
+	const gchar *end;
+
+	end = data + size;
+
+	if (size >= 3 && memcmp (data, "\xEF\xBB\xBF", 3) == 0)
+		data += 3;
+
+	while (data < end && g_ascii_isspace (*data))
+		data++;
+
+	return (data < end && *data == '{');
+}
+
+/*
+ * Checks @data is a JSON Feed, looking for its "version" among the members
+ * of the top level object. This usually is the first one, so the whole
+ * document is scanned only when it is not a JSON Feed
+ */
+gboolean
+feed_json_handler_check_format (const gchar *data, gsize size, GError **error)
+{
+	gboolean ret;
+	const gchar *key;
+	JsonTokenizer tok;
+
+	ret = FALSE;
+	json_tokenizer_init (&tok, data, size);
+
+	if (json_next (&tok, NULL) == JSON_TOKEN_OBJECT_START) {
+		while ((key = json_next_key (&tok)) != NULL) {
+			if (!strcmp (key, "version")) {
+				ret = (json_next (&tok, tok.text) == JSON_TOKEN_STRING &&
+				       g_str_has_prefix (tok.text->str, JSON_FEED_VERSION_PREFIX));
+				break;
+			}
+
+			json_skip_value (&tok);
+		}
+	}
+	else {
+		json_fail (&tok);
+	}
+
+	if (tok.failed) {
+		g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Invalid JSON!");
+		ret = FALSE;
+	}
+	else if (ret == FALSE) {
+		g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_FORMAT_ERROR, "Unknow format");
+	}
+
+	json_tokenizer_clear (&tok);
+	return ret;
+}
+
+/*
+ * Parses a document already accepted by feed_json_handler_check_format().
+ * Items are built only if @do_items is TRUE, applying the options found in
+ * @context as the other handlers do
+ */
+GList*
+feed_json_handler_parse (GrssFeedChannel *feed, const gchar *data, gsize size, gboolean do_items, FeedParseContext *context, GError **error)
+{
+	gchar *tmp;
+	const gchar *key;
+	GList *items;
+	JsonToken token;
+	JsonTokenizer tok;
+
+	items = NULL;
+	json_tokenizer_init (&tok, data, size);
+	tok.valid_utf8 = context->valid_utf8;
+	tok.limits = context->limits;
+	tok.nodes = context->nodes;
+	tok.text_size = context->text_size;
+	context->reversed = TRUE;
+
+	if (context->resume_offset != 0) {
+		/* a parsing split in slices continues from where it stopped,
+		   within the top level object and the array of items */
+		tok.depth = 2;
+		tok.pos = data + context->resume_offset;
+		context->resume_offset = 0;
+		items = parse_items (&tok, feed, context, items);
+	}
+	else if (json_next (&tok, NULL) != JSON_TOKEN_OBJECT_START) {
+		json_fail (&tok);
+	}
+
+	while (context->resume_offset == 0 && (key = json_next_key (&tok)) != NULL) {
+		if (!strcmp (key, "title")) {
+			if ((tmp = json_get_string (&tok)) != NULL)
+				grss_feed_channel_set_title_take (feed, tmp);
+		}
+		else if (!strcmp (key, "home_page_url")) {
+			if ((tmp = json_get_string (&tok)) != NULL)
+				grss_feed_channel_set_homepage_take (feed, tmp);
+		}
+		else if (!strcmp (key, "feed_url")) {
+			if ((tmp = json_get_string (&tok)) != NULL) {
+				grss_feed_channel_set_source (feed, tmp);
+				g_free (tmp);
+			}
+		}
+		else if (!strcmp (key, "description")) {
+			if ((tmp = json_get_string (&tok)) != NULL)
+				grss_feed_channel_set_description_take (feed, tmp);
+		}
+		else if (!strcmp (key, "icon")) {
+			if ((tmp = json_get_string (&tok)) != NULL) {
+				grss_feed_channel_set_image (feed, tmp);
+				g_free (tmp);
+			}
+		}
+		else if (!strcmp (key, "favicon")) {
+			if ((tmp = json_get_string (&tok)) != NULL) {
+				grss_feed_channel_set_icon (feed, tmp);
+				g_free (tmp);
+			}
+		}
+		else if (!strcmp (key, "language")) {
+			if ((tmp = json_get_string (&tok)) != NULL) {
+				grss_feed_channel_set_language (feed, tmp);
+				g_free (tmp);
+			}
+		}
+		else if (!strcmp (key, "authors") || !strcmp (key, "author")) {
+			set_channel_authors (feed, parse_authors (&tok));
+		}
+		else if (!strcmp (key, "hubs")) {
+			parse_hubs (&tok, feed);
+		}
+		else if (do_items == TRUE && !strcmp (key, "items")) {
+			token = json_next (&tok, NULL);
+			if (token == JSON_TOKEN_ARRAY_START)
+				items = parse_items (&tok, feed, context, items);
+			else
+				json_skip (&tok, token);
+		}
+		else {
+			json_skip_value (&tok);
+		}
+	}
+
+	if (tok.exceeded != NULL)
+		g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_LIMIT_EXCEEDED, "Document exceeds the limit on %s", tok.exceeded);
+	else if (tok.failed)
+		g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Invalid JSON!");
+	else
+		grss_feed_channel_set_format (feed, "application/feed+json");
+
+	if (tok.failed) {
+		g_list_free_full (items, g_object_unref);
+		items = NULL;
+		context->resume_offset = 0;
+	}
+
+	context->nodes = tok.nodes;
+	context->text_size = tok.text_size;
+
+	json_tokenizer_clear (&tok);
+	return items;
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2009-2015, Roberto Guido <rguido@src.gnome.org>
+ *                          Michele Tameni <michele@amdplanet.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __FEED_JSON_HANDLER_H__
+#define __FEED_JSON_HANDLER_H__
+
+#include "libgrss.h"
+#include "feed-handler.h"
+
+/*
+ * JSON Feed documents are not XML, so this is not a #FeedHandler: the
+ * contents are parsed as they are, without building a tree in memory
+ */
+
+gboolean	feed_json_handler_sniff		(const gchar *data, gsize size);
+gboolean	feed_json_handler_check_format	(const gchar *data, gsize size, GError **error);
+GList*		feed_json_handler_parse		(GrssFeedChannel *feed, const gchar *data, gsize size, gboolean do_items, FeedParseContext *context, GError **error);
+
+#endif /* __FEED_JSON_HANDLER_H__ */
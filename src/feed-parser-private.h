@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2009-2015, Roberto Guido <rguido@src.gnome.org>
+ *                          Michele Tameni <michele@amdplanet.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __FEED_PARSER_PRIVATE_H__
+#define __FEED_PARSER_PRIVATE_H__
+
+GList*		grss_feed_parser_parse_data_full	(GrssFeedParser *parser, GrssFeedChannel *feed, const gchar *data, gsize size,
+							 const gchar *url, const gchar *content_type, gboolean do_items, GError **error);
+GList*		grss_feed_parser_parse_file_full	(GrssFeedParser *parser, GrssFeedChannel *feed, const gchar *path,
+							 gboolean do_items, GError **error);
+
+void		grss_feed_parser_parse_sliced_async	(GrssFeedParser *parser, GrssFeedChannel *channel, GBytes *contents, const gchar *content_type,
+							 GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+GList*		grss_feed_parser_parse_sliced_finish	(GrssFeedParser *parser, GAsyncResult *result, GError **error);
+
+#endif
@@ -27,11 +27,14 @@
 
 #include "utils.h"
 #include "feed-parser.h"
+#include "feed-parser-private.h"
 #include "feed-handler.h"
+#include "feed-channel-private.h"
 
 #include "feed-rss-handler.h"
 #include "feed-atom-handler.h"
 #include "feed-pie-handler.h"
+#include "feed-json-handler.h"
 
 #define FEED_PARSER_GET_PRIVATE(o)	(G_TYPE_INSTANCE_GET_PRIVATE ((o), GRSS_FEED_PARSER_TYPE, GrssFeedParserPrivate))
 
@@ -43,20 +46,60 @@
  * #GrssFeedChannel provides to identify his type and invoke the correct parser.
  */
 
-#define FEED_PARSER_ERROR		grss_feed_parser_error_quark()
+/*
+ * A format known by the parser: the built-in ones have an @handler, the
+ * ones registered with grss_feed_parser_register_format() a @func
+ */
+typedef struct {
+	gchar *root_name;
+	gchar *ns_href;
+
+	FeedHandler *handler;
+
+	GrssFeedParserFormatFunc func;
+	gpointer user_data;
+	GDestroyNotify destroy;
+} FeedFormat;
 
 struct _GrssFeedParserPrivate {
+	NSHandler *ns_handler;
 	GSList *handlers;
-};
 
-enum {
-	FEED_PARSER_PARSE_ERROR,
-	FEED_PARSER_FORMAT_ERROR
+	/* name of root element -> GSList of FeedFormat */
+	GHashTable *roots;
+	GSList *formats;
+
+	gboolean lazy_content;
+	GrssFeedParserFields fields;
+	guint max_items;
+	gint xml_options;
+	GrssFeedParserLimits limits;
+
+	GrssFeedParserSeenFunc seen_func;
+	gpointer seen_data;
+	GDestroyNotify seen_destroy;
 };
 
 G_DEFINE_TYPE (GrssFeedParser, grss_feed_parser, G_TYPE_OBJECT)
+G_DEFINE_BOXED_TYPE (GrssFeedParserResult, grss_feed_parser_result, grss_feed_parser_result_copy, grss_feed_parser_result_free)
 
-static GQuark
+static void
+free_format (FeedFormat *format)
+{
+	if (format->destroy != NULL)
+		format->destroy (format->user_data);
+
+	g_free (format->root_name);
+	g_free (format->ns_href);
+	g_free (format);
+}
+
+/**
+ * grss_feed_parser_error_quark:
+ *
+ * Returns: the error domain of #GrssFeedParser.
+ */
+GQuark
 grss_feed_parser_error_quark ()
 {
 	return g_quark_from_static_string ("grss_feed_parser_error");
@@ -65,6 +108,15 @@ grss_feed_parser_error_quark ()
 static void
 grss_feed_parser_finalize (GObject *object)
 {
+	GrssFeedParser *parser;
+
+	parser = GRSS_FEED_PARSER (object);
+	grss_feed_parser_set_seen_func (parser, NULL, NULL, NULL);
+	g_hash_table_destroy (parser->priv->roots);
+	g_slist_free_full (parser->priv->formats, (GDestroyNotify) free_format);
+	g_slist_free_full (parser->priv->handlers, g_object_unref);
+	g_object_unref (parser->priv->ns_handler);
+
 	G_OBJECT_CLASS (grss_feed_parser_parent_class)->finalize (object);
 }
 
@@ -77,39 +129,78 @@ grss_feed_parser_class_init (GrssFeedParserClass *klass)
 	object_class->finalize = grss_feed_parser_finalize;
 }
 
-static void
-grss_feed_parser_init (GrssFeedParser *object)
+/*
+ * Formats are indexed by the name of the root element, and for each name
+ * the last added one is tried first
+ */
+static FeedFormat*
+add_format (GrssFeedParser *parser, const gchar *root_name, const gchar *ns_href)
 {
-	object->priv = FEED_PARSER_GET_PRIVATE (object);
+	GSList *candidates;
+	FeedFormat *format;
+
+	format = g_new0 (FeedFormat, 1);
+	format->root_name = g_strdup (root_name);
+	format->ns_href = g_strdup (ns_href);
+	parser->priv->formats = g_slist_prepend (parser->priv->formats, format);
+
+	/* the previous list is extended, not to be freed by the hash table */
+	candidates = g_hash_table_lookup (parser->priv->roots, format->root_name);
+	g_hash_table_steal (parser->priv->roots, format->root_name);
+	candidates = g_slist_prepend (candidates, format);
+	g_hash_table_insert (parser->priv->roots, format->root_name, candidates);
+
+	return format;
 }
 
-static GSList*
-feed_parsers_get_list (GrssFeedParser *parser)
+static void
+add_handler (GrssFeedParser *parser, FeedHandler *handler)
 {
-	FeedHandler *feed;
-	NSHandler *ns;
+	guint i;
+	gchar *name;
+	const gchar *ns_href;
+	const gchar **roots;
 
-	ns = ns_handler_new ();
+	feed_handler_set_ns_handler (handler, parser->priv->ns_handler);
+	parser->priv->handlers = g_slist_prepend (parser->priv->handlers, handler);
+	roots = feed_handler_get_roots (handler);
 
-	if (parser->priv->handlers == NULL) {
-		/*
-			TODO	Parsers may be dinamically loaded and managed as external plugins
-		*/
+	/* each root may be followed by "|" and the required namespace */
+	for (i = 0; roots [i] != NULL; i++) {
+		ns_href = strchr (roots [i], '|');
+
+		if (ns_href == NULL) {
+			add_format (parser, roots [i], NULL)->handler = handler;
+		}
+		else {
+			name = g_strndup (roots [i], ns_href - roots [i]);
+			add_format (parser, name, ns_href + 1)->handler = handler;
+			g_free (name);
+		}
+	}
+}
 
-		feed = FEED_HANDLER (feed_rss_handler_new ());
-		feed_handler_set_ns_handler (feed, ns);
-		parser->priv->handlers = g_slist_append (parser->priv->handlers, feed);
+static void
+grss_feed_parser_init (GrssFeedParser *object)
+{
+	object->priv = FEED_PARSER_GET_PRIVATE (object);
+	object->priv->fields = GRSS_FEED_PARSER_FIELDS_ALL;
+	object->priv->xml_options = GRSS_FEED_PARSER_XML_OPTIONS_DEFAULT;
 
-		feed = FEED_HANDLER (feed_atom_handler_new ());					/* Must be before pie */
-		feed_handler_set_ns_handler (feed, ns);
-		parser->priv->handlers = g_slist_append (parser->priv->handlers, feed);
+	/*
+		Handlers are created here once for all. Only
+		grss_feed_parser_register_format() and
+		grss_feed_parser_register_namespace() modify them, and are to
+		be called before the parser is used: after that the handlers
+		are just read, so the same parser can be used from many threads
+	*/
 
-		feed = FEED_HANDLER (feed_pie_handler_new ());
-		feed_handler_set_ns_handler (feed, ns);
-		parser->priv->handlers = g_slist_append (parser->priv->handlers, feed);
-	}
+	object->priv->roots = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) g_slist_free);
+	object->priv->ns_handler = ns_handler_new ();
 
-	return parser->priv->handlers;
+	add_handler (object, FEED_HANDLER (feed_rss_handler_new ()));
+	add_handler (object, FEED_HANDLER (feed_pie_handler_new ()));
+	add_handler (object, FEED_HANDLER (feed_atom_handler_new ()));		/* Must be after pie, to be tried before */
 }
 
 /**
@@ -128,19 +219,21 @@ grss_feed_parser_new ()
 	return parser;
 }
 
-static FeedHandler*
-retrieve_feed_handler (GrssFeedParser *parser, xmlDocPtr doc, xmlNodePtr cur)
+static FeedFormat*
+retrieve_feed_format (GrssFeedParser *parser, xmlDocPtr doc, xmlNodePtr cur)
 {
 	GSList *iter;
-	FeedHandler *handler;
+	FeedFormat *format;
 
-	iter = feed_parsers_get_list (parser);
+	iter = g_hash_table_lookup (parser->priv->roots, cur->name);
 
 	while (iter) {
-		handler = (FeedHandler*) (iter->data);
+		format = (FeedFormat*) (iter->data);
 
-		if (handler && feed_handler_check_format (handler, doc, cur))
-			return handler;
+		if (format->ns_href == NULL)
+			return format;
+		if (cur->ns != NULL && cur->ns->href != NULL && xmlStrEqual (cur->ns->href, BAD_CAST format->ns_href))
+			return format;
 
 		iter = g_slist_next (iter);
 	}
@@ -148,17 +241,50 @@ retrieve_feed_handler (GrssFeedParser *parser, xmlDocPtr doc, xmlNodePtr cur)
 	return NULL;
 }
 
-static FeedHandler*
+static void
+init_context (GrssFeedParser *parser, GrssFeedChannel *feed, FeedParseContext *context)
+{
+	guint channel_max;
+
+	memset (context, 0, sizeof (FeedParseContext));
+	context->lazy_content = parser->priv->lazy_content;
+	context->fields = parser->priv->fields;
+
+	/* the most restrictive limit wins */
+	context->max_items = parser->priv->max_items;
+	channel_max = grss_feed_channel_get_max_items (feed);
+	if (channel_max != 0 && (context->max_items == 0 || channel_max < context->max_items))
+		context->max_items = channel_max;
+
+	context->seen_func = parser->priv->seen_func;
+	context->seen_data = parser->priv->seen_data;
+	context->limits = &parser->priv->limits;
+
+	if (parser->priv->limits.max_parse_time != 0)
+		context->deadline = g_get_monotonic_time () + (gint64) parser->priv->limits.max_parse_time * 1000;
+}
+
+static void
+clear_context (FeedParseContext *context)
+{
+	if (context->scratch != NULL)
+		g_object_unref (context->scratch);
+
+	g_free (context->base_url);
+	FREE_INTERNED (context->namespaces);
+}
+
+static FeedFormat*
 init_parsing (GrssFeedParser *parser, xmlDocPtr doc, GError **error)
 {
 	xmlNodePtr cur;
-	FeedHandler *handler;
+	FeedFormat *handler;
 
 	handler = NULL;
 
 	do {
 		if ((cur = xmlDocGetRootElement (doc)) == NULL) {
-			g_set_error (error, FEED_PARSER_ERROR, FEED_PARSER_PARSE_ERROR, "Empty document!");
+			g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Empty document!");
 			break;
 		}
 
@@ -166,18 +292,18 @@ init_parsing (GrssFeedParser *parser, xmlDocPtr doc, GError **error)
 			cur = cur->next;
 
 		if (!cur) {
-			g_set_error (error, FEED_PARSER_ERROR, FEED_PARSER_PARSE_ERROR, "Empty XML document!");
+			g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Empty XML document!");
 			break;
 		}
 
 		if (!cur->name) {
-			g_set_error (error, FEED_PARSER_ERROR, FEED_PARSER_PARSE_ERROR, "Invalid XML!");
+			g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Invalid XML!");
 			break;
 		}
 
-		handler = retrieve_feed_handler (parser, doc, cur);
+		handler = retrieve_feed_format (parser, doc, cur);
 		if (handler == NULL) {
-			g_set_error (error, FEED_PARSER_ERROR, FEED_PARSER_FORMAT_ERROR, "Unknow format");
+			g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_FORMAT_ERROR, "Unknow format");
 			break;
 		}
 
@@ -186,6 +312,112 @@ init_parsing (GrssFeedParser *parser, xmlDocPtr doc, GError **error)
 	return handler;
 }
 
+/*
+ * Items returned by registered formats pass through the same filters
+ * applied by the built-in handlers
+ */
+static GList*
+collect_format_items (GList *items, GrssFeedChannel *feed, FeedParseContext *context)
+{
+	time_t now;
+	GList *iter;
+	GList *ret;
+	GrssFeedItem *item;
+
+	now = time (NULL);
+	ret = NULL;
+
+	for (iter = items; iter; iter = g_list_next (iter)) {
+		item = iter->data;
+
+		if (feed_parse_context_is_full (context))
+			g_object_unref (item);
+		else if (feed_parse_context_collect_item (context, feed, item, now))
+			ret = g_list_prepend (ret, item);
+	}
+
+	g_list_free (items);
+	return g_list_reverse (ret);
+}
+
+/* a partial list is not returned, the caller may take it as complete */
+static GList*
+check_time_limit (GList *items, FeedParseContext *context, GError *err, GError **error)
+{
+	if (err == NULL && context->timed_out) {
+		g_list_free_full (items, g_object_unref);
+		items = NULL;
+		g_set_error (&err, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_LIMIT_EXCEEDED, "Document exceeds the limit on parse time");
+	}
+
+	if (err != NULL)
+		g_propagate_error (error, err);
+
+	return items;
+}
+
+static GList*
+run_format (FeedFormat *format, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, FeedParseContext *context, GError **error)
+{
+	GList *items;
+	GError *err;
+
+	err = NULL;
+
+	if (format->handler != NULL) {
+		items = feed_handler_parse (format->handler, feed, doc, do_items, context, &err);
+	}
+	else {
+		items = format->func (feed, doc, do_items, format->user_data, &err);
+		items = collect_format_items (items, feed, context);
+	}
+
+	return check_time_limit (items, context, err, error);
+}
+
+static GList*
+run_json (GrssFeedChannel *feed, const gchar *data, gsize size, gboolean do_items, FeedParseContext *context, GError **error)
+{
+	GList *items;
+	GError *err;
+
+	err = NULL;
+	items = feed_json_handler_parse (feed, data, size, do_items, context, &err);
+	return check_time_limit (items, context, err, error);
+}
+
+/*
+ * JSON Feed documents are routed to their own handler, before trying to
+ * read them as XML
+ */
+static gboolean
+is_json_document (const gchar *data, gsize size, const gchar *content_type)
+{
+	if (content_type_is (content_type, "application/feed+json") || content_type_is (content_type, "application/json"))
+		return TRUE;
+
+	return feed_json_handler_sniff (data, size);
+}
+
+/*
+ * Once normalized to UTF-8, the contents are not to be converted again
+ * according to the encoding they declare
+ */
+static gint
+normalized_xml_options (GrssFeedParser *parser, CharsetNormalizer *normalizer)
+{
+	if (charset_normalizer_is_utf8 (normalizer))
+		return parser->priv->xml_options | XML_PARSE_IGNORE_ENC;
+	else
+		return parser->priv->xml_options;
+}
+
+static void
+report_encoding (GrssFeedChannel *feed, CharsetNormalizer *normalizer)
+{
+	grss_feed_channel_set_encoding (feed, charset_normalizer_get_encoding (normalizer), charset_normalizer_get_charset (normalizer));
+}
+
 /**
  * grss_feed_parser_parse:
  * @parser: a #GrssFeedParser.
@@ -197,6 +429,11 @@ init_parsing (GrssFeedParser *parser, xmlDocPtr doc, GError **error)
  * Parses the given XML @doc, belonging to the given @feed, to obtain a list
  * of #GrssFeedItem.
  *
+ * Items already known to the caller, as reported by the function set with
+ * grss_feed_parser_set_seen_func(), are skipped and not included in the list.
+ * No more than the number of items set with grss_feed_parser_set_max_items()
+ * or grss_feed_channel_set_max_items() are returned.
+ *
  * Returns: (element-type GrssFeedItem) (transfer full): a list of
  * #GrssFeedItem, to be freed when no longer in use, or NULL if anerror occours
  * and @error is set.
@@ -204,14 +441,21 @@ init_parsing (GrssFeedParser *parser, xmlDocPtr doc, GError **error)
 GList*
 grss_feed_parser_parse (GrssFeedParser *parser, GrssFeedChannel *feed, xmlDocPtr doc, GError **error)
 {
-	FeedHandler *handler;
+	GList *items;
+	FeedFormat *handler;
+	FeedParseContext context;
 
 	handler = init_parsing (parser, doc, error);
 
-	if (handler != NULL)
-		return feed_handler_parse (handler, feed, doc, TRUE, error);
-	else
+	if (handler != NULL) {
+		init_context (parser, feed, &context);
+		items = run_format (handler, feed, doc, TRUE, &context, error);
+		clear_context (&context);
+		return items;
+	}
+	else {
 		return NULL;
+	}
 }
 
 /**
@@ -230,10 +474,1442 @@ grss_feed_parser_parse (GrssFeedParser *parser, GrssFeedChannel *feed, xmlDocPtr
 void
 grss_feed_parser_parse_channel (GrssFeedParser *parser, GrssFeedChannel *feed, xmlDocPtr doc, GError **error)
 {
-	FeedHandler *handler;
+	FeedFormat *handler;
+	FeedParseContext context;
+
+	handler = init_parsing (parser, doc, error);
+	if (handler != NULL) {
+		init_context (parser, feed, &context);
+		run_format (handler, feed, doc, FALSE, &context, error);
+		clear_context (&context);
+	}
+}
+
+/**
+ * grss_feed_parser_parse_records:
+ * @parser: a #GrssFeedParser.
+ * @feed: a #GrssFeedChannel to be parsed.
+ * @doc: XML document extracted from the contents of the feed, which must
+ *       already been fetched.
+ * @error: location for eventual errors.
+ *
+ * Similar to grss_feed_parser_parse(), but the items are returned as
+ * #GrssFeedItemRecord, in the same order they have into the document.
+ * Records are lighter than #GrssFeedItem objects, and cheaper to build and
+ * destroy: this is intended for applications ingesting large amounts of
+ * items. When required, a record may be converted with
+ * grss_feed_item_record_to_item().
+ *
+ * Returns: (element-type GrssFeedItemRecord) (transfer full): an array of
+ * #GrssFeedItemRecord, to be freed with g_ptr_array_unref(), or %NULL if an
+ * error occurs and @error is set.
+ */
+GPtrArray*
+grss_feed_parser_parse_records (GrssFeedParser *parser, GrssFeedChannel *feed, xmlDocPtr doc, GError **error)
+{
+	GError *err;
+	GPtrArray *records;
+	FeedFormat *handler;
+	FeedParseContext context;
+
+	handler = init_parsing (parser, doc, error);
+	if (handler == NULL)
+		return NULL;
+
+	err = NULL;
+	records = g_ptr_array_new_with_free_func ((GDestroyNotify) grss_feed_item_record_free);
+
+	init_context (parser, feed, &context);
+	context.records = records;
+	run_format (handler, feed, doc, TRUE, &context, &err);
+	clear_context (&context);
+
+	if (err != NULL) {
+		g_propagate_error (error, err);
+		g_ptr_array_unref (records);
+		records = NULL;
+	}
+
+	return records;
+}
+
+/**
+ * grss_feed_parser_parse_foreach:
+ * @parser: a #GrssFeedParser.
+ * @feed: a #GrssFeedChannel to be parsed.
+ * @doc: XML document extracted from the contents of the feed, which must
+ *       already been fetched.
+ * @func: (scope call): function invoked for each item.
+ * @user_data: data to pass to @func.
+ * @error: location for eventual errors.
+ *
+ * Similar to grss_feed_parser_parse(), but each #GrssFeedItem is passed to
+ * @func as soon as it is parsed, in the same order it has into the
+ * document, and no list is built: this way only the items retained by @func
+ * are kept in memory. The parsing stops when @func returns %FALSE.
+ *
+ * Returns: %FALSE if an error occurs and @error is set, %TRUE otherwise.
+ */
+gboolean
+grss_feed_parser_parse_foreach (GrssFeedParser *parser, GrssFeedChannel *feed, xmlDocPtr doc,
+                                GrssFeedParserForeachFunc func, gpointer user_data, GError **error)
+{
+	GError *err;
+	FeedFormat *handler;
+	FeedParseContext context;
+
+	g_return_val_if_fail (func != NULL, FALSE);
 
 	handler = init_parsing (parser, doc, error);
-	if (handler != NULL)
-		feed_handler_parse (handler, feed, doc, FALSE, error);
+	if (handler == NULL)
+		return FALSE;
+
+	err = NULL;
+
+	init_context (parser, feed, &context);
+	context.foreach_func = func;
+	context.foreach_data = user_data;
+	run_format (handler, feed, doc, TRUE, &context, &err);
+	clear_context (&context);
+
+	if (err != NULL) {
+		g_propagate_error (error, err);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* consumes @doc, read with the eventual error @err */
+static GList*
+parse_read_document (GrssFeedParser *parser, GrssFeedChannel *feed, xmlDocPtr doc, GError *err, gboolean do_items, GError **error)
+{
+	GList *items;
+
+	items = NULL;
+
+	if (doc == NULL) {
+		if (err == NULL)
+			g_set_error (&err, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Unable to parse document");
+		g_propagate_error (error, err);
+		return NULL;
+	}
+
+	if (do_items)
+		items = grss_feed_parser_parse (parser, feed, doc, error);
+	else
+		grss_feed_parser_parse_channel (parser, feed, doc, error);
+
+	xmlFreeDoc (doc);
+	return items;
+}
+
+/*
+ * As grss_feed_parser_parse() or grss_feed_parser_parse_channel(), for
+ * contents not yet parsed. @url is used to resolve relative references in
+ * XML documents, @content_type is the value of the Content-Type header and
+ * helps to guess the format and the charset of the document: both may be
+ * NULL. The contents are normalized to UTF-8 before the parsing
+ */
+GList*
+grss_feed_parser_parse_data_full (GrssFeedParser *parser, GrssFeedChannel *feed, const gchar *data, gsize size,
+                                  const gchar *url, const gchar *content_type, gboolean do_items, GError **error)
+{
+	gsize normal_size;
+	gboolean json;
+	const gchar *normal;
+	GList *items;
+	xmlDocPtr doc;
+	GError *err;
+	CharsetNormalizer *normalizer;
+	FeedParseContext context;
+
+	items = NULL;
+
+	if (data == NULL || size == 0) {
+		g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Empty document!");
+		return NULL;
+	}
+
+	json = is_json_document (data, size, content_type);
+
+	normalizer = charset_normalizer_new (data, size, content_type, json == FALSE);
+	normal = charset_normalizer_feed (normalizer, data, size, TRUE, &normal_size);
+	report_encoding (feed, normalizer);
+
+	if (json) {
+		if (feed_json_handler_check_format (normal, normal_size, error)) {
+			init_context (parser, feed, &context);
+			context.valid_utf8 = charset_normalizer_is_utf8 (normalizer);
+			items = run_json (feed, normal, normal_size, do_items, &context, error);
+			clear_context (&context);
+		}
+
+		charset_normalizer_free (normalizer);
+		return items;
+	}
+
+	err = NULL;
+	doc = content_to_xml_full (normal, normal_size, url, normalized_xml_options (parser, normalizer), &parser->priv->limits, &err);
+	charset_normalizer_free (normalizer);
+
+	return parse_read_document (parser, feed, doc, err, do_items, error);
+}
+
+/*
+ * As grss_feed_parser_parse_data_full(), for the file in @path, which is
+ * mapped in memory. Files compressed with gzip are read by libxml2, which
+ * inflates them
+ */
+GList*
+grss_feed_parser_parse_file_full (GrssFeedParser *parser, GrssFeedChannel *feed, const gchar *path,
+                                  gboolean do_items, GError **error)
+{
+	gsize size;
+	const gchar *data;
+	GList *items;
+	xmlDocPtr doc;
+	GError *err;
+	GMappedFile *mapped;
+
+	mapped = g_mapped_file_new (path, FALSE, error);
+	if (mapped == NULL)
+		return NULL;
+
+	data = g_mapped_file_get_contents (mapped);
+	size = g_mapped_file_get_length (mapped);
+
+	if (data == NULL || is_gzip_data (data, size) == FALSE) {
+		items = grss_feed_parser_parse_data_full (parser, feed, data, size, path, NULL, do_items, error);
+		g_mapped_file_unref (mapped);
+		return items;
+	}
+
+	g_mapped_file_unref (mapped);
+
+	err = NULL;
+	doc = file_to_xml_full (path, parser->priv->xml_options, &parser->priv->limits, &err);
+	return parse_read_document (parser, feed, doc, err, do_items, error);
+}
+
+/**
+ * grss_feed_parser_parse_data:
+ * @parser: a #GrssFeedParser.
+ * @feed: a #GrssFeedChannel to be parsed.
+ * @data: (array length=size): contents of the feed, as fetched.
+ * @size: length of @data.
+ * @error: location for eventual errors.
+ *
+ * Similar to grss_feed_parser_parse(), but parses the raw contents of the
+ * feed. Documents in the JSON Feed format (https://jsonfeed.org/) are
+ * recognized and parsed as they are; anything else is read as XML, with the
+ * options set with grss_feed_parser_set_xml_options() and the limits set with
+ * grss_feed_parser_set_limits().
+ *
+ * Contents in a charset other than UTF-8, or with invalid UTF-8 sequences,
+ * are converted before the parsing: what has been done is then reported by
+ * grss_feed_channel_get_encoding().
+ *
+ * Returns: (element-type GrssFeedItem) (transfer full): a list of
+ * #GrssFeedItem, to be freed when no longer in use, or %NULL if an error
+ * occurs and @error is set.
+ */
+GList*
+grss_feed_parser_parse_data (GrssFeedParser *parser, GrssFeedChannel *feed, const gchar *data, gsize size, GError **error)
+{
+	return grss_feed_parser_parse_data_full (parser, feed, data, size, NULL, NULL, TRUE, error);
+}
+
+/*
+	A parsing split in many slices is driven by an idle source: each
+	iteration first reads a few chunks of the document, then builds a few
+	items, until SLICE_TIME microseconds have passed, so that the main loop
+	is never blocked for long. This permits to parse large feeds in
+	applications not using threads. Only the time spent into the slices
+	counts towards the limit on the parse time
+*/
+#define SLICE_TIME		5000
+#define SLICE_CHUNK_SIZE	(64 * 1024)
+
+typedef struct {
+	GrssFeedChannel	*channel;
+	GBytes		*contents;
+	gsize		offset;
+	XmlPushReader	*reader;
+	CharsetNormalizer *normalizer;
+
+	/* JSON documents need no reading, items are built since the first
+	   slice from their normalized contents */
+	gboolean	json;
+	const gchar	*json_data;
+	gsize		json_size;
+
+	xmlDocPtr	doc;
+	FeedFormat	*format;
+	gboolean	has_context;
+	FeedParseContext context;
+	GList		*items;
+
+	/* time spent into the previous slices */
+	gint64		elapsed;
+} SlicedParsing;
+
+static void
+free_sliced_parsing (gpointer data)
+{
+	SlicedParsing *job;
+
+	job = data;
+
+	if (job->reader != NULL)
+		xml_push_reader_free (job->reader);
+
+	if (job->normalizer != NULL)
+		charset_normalizer_free (job->normalizer);
+
+	if (job->has_context)
+		clear_context (&job->context);
+
+	if (job->doc != NULL)
+		xmlFreeDoc (job->doc);
+
+	g_list_free_full (job->items, g_object_unref);
+	g_bytes_unref (job->contents);
+	g_object_unref (job->channel);
+	g_free (job);
+}
+
+static void
+free_items_list (gpointer list)
+{
+	g_list_free_full (list, g_object_unref);
+}
+
+/* returns FALSE when the whole document has been read */
+static gboolean
+read_slice (GrssFeedParser *parser, SlicedParsing *job, gint64 slice_end, GError **error)
+{
+	gsize size;
+	gsize chunk;
+	gsize normal_size;
+	gboolean valid;
+	const gchar *normal;
+	const gchar *contents;
+
+	contents = g_bytes_get_data (job->contents, &size);
+
+	do {
+		chunk = MIN (SLICE_CHUNK_SIZE, size - job->offset);
+		normal = charset_normalizer_feed (job->normalizer, contents + job->offset, chunk,
+		                                  job->offset + chunk == size, &normal_size);
+		valid = xml_push_reader_feed (job->reader, normal, normal_size);
+		job->offset += chunk;
+	} while (valid && job->offset < size && g_get_monotonic_time () < slice_end);
+
+	if (valid && job->offset < size)
+		return TRUE;
+
+	report_encoding (job->channel, job->normalizer);
+
+	job->doc = xml_push_reader_finish (job->reader, error);
+	job->reader = NULL;
+
+	if (job->doc == NULL) {
+		if (*error == NULL)
+			g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Unable to parse document");
+	}
+	else {
+		job->format = init_parsing (parser, job->doc, error);
+		if (job->format != NULL) {
+			init_context (parser, job->channel, &job->context);
+			job->has_context = TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* builds a part of the result before @slice_end, see parse_slice() */
+static gboolean
+run_slice (GTask *task, SlicedParsing *job, gint64 slice_end, gint64 deadline)
+{
+	GList *items;
+	GError *error;
+	GrssFeedParser *parser;
+
+	error = NULL;
+	parser = g_task_get_source_object (task);
+
+	if (job->json == FALSE && job->doc == NULL) {
+		xml_push_reader_set_deadline (job->reader, deadline);
+
+		if (read_slice (parser, job, slice_end, &error) == TRUE)
+			return G_SOURCE_CONTINUE;
+
+		if (error != NULL) {
+			g_task_return_error (task, error);
+			return G_SOURCE_REMOVE;
+		}
+
+		/* items are built starting from the next slice */
+		return G_SOURCE_CONTINUE;
+	}
+
+	job->context.slice_end = slice_end;
+	job->context.deadline = deadline;
+
+	if (job->json)
+		items = run_json (job->channel, job->json_data, job->json_size, TRUE, &job->context, &error);
+	else
+		items = run_format (job->format, job->channel, job->doc, TRUE, &job->context, &error);
+
+	if (error != NULL) {
+		g_list_free_full (items, g_object_unref);
+		g_task_return_error (task, error);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* the list is built in the same order of an uninterrupted parsing */
+	if (job->context.reversed)
+		job->items = g_list_concat (items, job->items);
+	else
+		job->items = g_list_concat (job->items, items);
+
+	if (job->context.resume != NULL || job->context.resume_offset != 0)
+		return G_SOURCE_CONTINUE;
+
+	g_task_return_pointer (task, job->items, free_items_list);
+	job->items = NULL;
+	return G_SOURCE_REMOVE;
 }
 
+static gboolean
+parse_slice (gpointer user_data)
+{
+	GTask *task;
+	gint64 start;
+	gint64 deadline;
+	gboolean ret;
+	SlicedParsing *job;
+	GrssFeedParser *parser;
+
+	task = user_data;
+	job = g_task_get_task_data (task);
+	parser = g_task_get_source_object (task);
+
+	if (g_task_return_error_if_cancelled (task))
+		return G_SOURCE_REMOVE;
+
+	/* the time spent waiting in the main loop is not counted */
+	start = g_get_monotonic_time ();
+	deadline = 0;
+	if (parser->priv->limits.max_parse_time != 0)
+		deadline = start + (gint64) parser->priv->limits.max_parse_time * 1000 - job->elapsed;
+
+	ret = run_slice (task, job, start + SLICE_TIME, deadline);
+
+	if (ret == G_SOURCE_CONTINUE)
+		job->elapsed += g_get_monotonic_time () - start;
+
+	return ret;
+}
+
+/*
+ * As grss_feed_parser_parse(), but the document is read from @contents and
+ * parsed in many slices, within the main loop of the thread-default
+ * context. @content_type, if known, helps to guess the format and the
+ * charset of the document. The parser has not to be modified in the
+ * meantime
+ */
+void
+grss_feed_parser_parse_sliced_async (GrssFeedParser *parser, GrssFeedChannel *channel, GBytes *contents, const gchar *content_type,
+                                     GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+	gsize size;
+	GTask *task;
+	GError *error;
+	GSource *source;
+	gconstpointer data;
+	SlicedParsing *job;
+
+	job = g_new0 (SlicedParsing, 1);
+	job->channel = g_object_ref (channel);
+	job->contents = g_bytes_ref (contents);
+
+	task = g_task_new (parser, cancellable, callback, user_data);
+	g_task_set_task_data (task, job, free_sliced_parsing);
+
+	error = NULL;
+	data = g_bytes_get_data (contents, &size);
+
+	job->json = is_json_document (data, size, content_type);
+	job->normalizer = charset_normalizer_new (data, size, content_type, job->json == FALSE);
+
+	if (job->json) {
+		job->json_data = charset_normalizer_feed (job->normalizer, data, size, TRUE, &job->json_size);
+		report_encoding (channel, job->normalizer);
+
+		if (feed_json_handler_check_format (job->json_data, job->json_size, &error)) {
+			init_context (parser, channel, &job->context);
+			job->context.valid_utf8 = charset_normalizer_is_utf8 (job->normalizer);
+			job->has_context = TRUE;
+		}
+	}
+	else {
+		job->reader = xml_push_reader_new (NULL, normalized_xml_options (parser, job->normalizer), &parser->priv->limits);
+		if (job->reader == NULL)
+			g_set_error (&error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Unable to parse document");
+	}
+
+	if (error != NULL) {
+		g_task_return_error (task, error);
+	}
+	else {
+		g_task_set_priority (task, G_PRIORITY_DEFAULT_IDLE);
+		source = g_idle_source_new ();
+		g_task_attach_source (task, source, parse_slice);
+		g_source_unref (source);
+	}
+
+	g_object_unref (task);
+}
+
+/*
+ * Returns the items parsed by grss_feed_parser_parse_sliced_async(), or
+ * NULL if @error is set
+ */
+GList*
+grss_feed_parser_parse_sliced_finish (GrssFeedParser *parser, GAsyncResult *result, GError **error)
+{
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+typedef struct {
+	GrssFeedParser	*parser;
+	const gchar	**paths;
+	GBytes		**buffers;
+	GPtrArray	*results;
+} ParseManyJob;
+
+static void
+parse_many_worker (gpointer data, gpointer user_data)
+{
+	guint index;
+	gsize size;
+	gconstpointer contents;
+	ParseManyJob *job;
+	GrssFeedParserResult *result;
+
+	index = GPOINTER_TO_UINT (data) - 1;
+	job = user_data;
+	result = g_ptr_array_index (job->results, index);
+	result->channel = grss_feed_channel_new ();
+
+	if (job->paths != NULL) {
+		result->items = grss_feed_parser_parse_file_full (job->parser, result->channel, job->paths [index], TRUE, &result->error);
+	}
+	else {
+		contents = g_bytes_get_data (job->buffers [index], &size);
+		result->items = grss_feed_parser_parse_data_full (job->parser, result->channel, contents, size, NULL, NULL, TRUE, &result->error);
+	}
+
+	if (result->error != NULL)
+		g_clear_object (&result->channel);
+}
+
+/**
+ * grss_feed_parser_parse_many:
+ * @parser: a #GrssFeedParser.
+ * @paths: (array zero-terminated=1) (allow-none): paths of the files to
+ *         parse, or %NULL.
+ * @buffers: (array zero-terminated=1) (allow-none): contents of the
+ *           documents to parse, or %NULL. Only one of @paths and @buffers
+ *           can be set.
+ * @threads: number of threads to use, or 0 to use one for each available
+ *           processor.
+ *
+ * Parses many documents at once, distributing them across many threads:
+ * each thread takes the next document to parse as soon as it is free.
+ * The options of the @parser apply to all documents; if a function has
+ * been set with grss_feed_parser_set_seen_func() it may be invoked from
+ * many threads at the same time.
+ *
+ * Returns: (element-type GrssFeedParserResult) (transfer full): an array of
+ * #GrssFeedParserResult, one for each document and in the same order. Free
+ * it with g_ptr_array_unref().
+ */
+GPtrArray*
+grss_feed_parser_parse_many (GrssFeedParser *parser, const gchar **paths, GBytes **buffers, guint threads)
+{
+	guint i;
+	guint num;
+	GThreadPool *pool;
+	ParseManyJob job;
+
+	g_return_val_if_fail ((paths == NULL) != (buffers == NULL), NULL);
+
+	if (paths != NULL)
+		num = g_strv_length ((gchar**) paths);
+	else
+		for (num = 0; buffers [num] != NULL; num++);
+
+	job.parser = parser;
+	job.paths = paths;
+	job.buffers = buffers;
+	job.results = g_ptr_array_new_full (num, (GDestroyNotify) grss_feed_parser_result_free);
+
+	for (i = 0; i < num; i++)
+		g_ptr_array_add (job.results, g_new0 (GrssFeedParserResult, 1));
+
+	if (threads == 0)
+		threads = g_get_num_processors ();
+	if (threads > num)
+		threads = num;
+
+	if (threads <= 1) {
+		for (i = 0; i < num; i++)
+			parse_many_worker (GUINT_TO_POINTER (i + 1), &job);
+	}
+	else {
+		/* to be called before using libxml2 in many threads */
+		xmlInitParser ();
+
+		pool = g_thread_pool_new (parse_many_worker, &job, threads, TRUE, NULL);
+
+		for (i = 0; i < num; i++)
+			g_thread_pool_push (pool, GUINT_TO_POINTER (i + 1), NULL);
+
+		/* waits all documents have been parsed */
+		g_thread_pool_free (pool, FALSE, TRUE);
+	}
+
+	return job.results;
+}
+
+/**
+ * grss_feed_parser_result_copy:
+ * @result: a #GrssFeedParserResult.
+ *
+ * Duplicates a #GrssFeedParserResult: channel and items are shared with
+ * the original one, with a new reference.
+ *
+ * Returns: (transfer full): a new #GrssFeedParserResult, to be freed with
+ * grss_feed_parser_result_free().
+ */
+GrssFeedParserResult*
+grss_feed_parser_result_copy (GrssFeedParserResult *result)
+{
+	GrssFeedParserResult *ret;
+
+	ret = g_new0 (GrssFeedParserResult, 1);
+
+	if (result->channel != NULL)
+		ret->channel = g_object_ref (result->channel);
+	ret->items = g_list_copy_deep (result->items, (GCopyFunc) g_object_ref, NULL);
+	if (result->error != NULL)
+		ret->error = g_error_copy (result->error);
+
+	return ret;
+}
+
+/**
+ * grss_feed_parser_result_free:
+ * @result: a #GrssFeedParserResult.
+ *
+ * Frees a #GrssFeedParserResult and all its contents.
+ */
+void
+grss_feed_parser_result_free (GrssFeedParserResult *result)
+{
+	if (result->channel != NULL)
+		g_object_unref (result->channel);
+	g_list_free_full (result->items, g_object_unref);
+	if (result->error != NULL)
+		g_error_free (result->error);
+	g_free (result);
+}
+
+/*
+	A stream reads the document a chunk at a time, as it is downloaded, and
+	each item is built and passed to the foreach function as soon as its
+	element is closed; then the element is dropped from the tree. So only the
+	channel and the item being read are kept in memory, whatever is the size
+	of the document. The elements after the last item are parsed when the
+	stream is finished
+*/
+#define STREAM_HEAD_SIZE	1024
+
+struct _GrssFeedParserStream {
+	GrssFeedParser	*parser;
+	GrssFeedChannel	*channel;
+	GrssFeedParserForeachFunc func;
+	gpointer	user_data;
+	gchar		*content_type;
+
+	/* the first bytes are collected to guess format and charset */
+	GString		*head;
+
+	CharsetNormalizer *normalizer;
+	XmlPushReader	*reader;
+	GrssFeedParserLimits limits;
+
+	/* JSON documents are parsed only once complete */
+	GString		*json;
+	gsize		size;
+
+	FeedFormat	*format;
+	gboolean	has_context;
+	FeedParseContext context;
+	xmlNodePtr	prefix;
+	gboolean	done;
+	GError		*error;
+};
+
+/*
+ * TRUE if @node is an item at the level where handlers look for them: the
+ * entries of an Atom feed, the items of a RSS channel or of a RDF document
+ */
+static gboolean
+is_stream_item (xmlNodePtr node)
+{
+	xmlNodePtr parent;
+
+	parent = node->parent;
+	if (parent == NULL || parent->type != XML_ELEMENT_NODE)
+		return FALSE;
+
+	if (xmlStrEqual (node->name, BAD_CAST"entry"))
+		return (parent->parent->type == XML_DOCUMENT_NODE);
+
+	if (xmlStrEqual (node->name, BAD_CAST"item") == FALSE)
+		return FALSE;
+
+	if (parent->parent->type == XML_DOCUMENT_NODE)
+		return TRUE;
+
+	return (parent->parent->parent != NULL && parent->parent->parent->type == XML_DOCUMENT_NODE &&
+	        (!xmlStrcmp (parent->name, BAD_CAST"channel") || !xmlStrcmp (parent->name, BAD_CAST"Channel") ||
+	         !xmlStrcmp (parent->name, BAD_CAST"items")));
+}
+
+static void
+stream_stop (GrssFeedParserStream *stream, GError *error)
+{
+	if (error != NULL && stream->error == NULL)
+		stream->error = error;
+	else if (error != NULL)
+		g_error_free (error);
+
+	stream->done = TRUE;
+	if (stream->reader != NULL)
+		xml_push_reader_stop (stream->reader);
+}
+
+/*
+ * Documents which are not streamed, as JSON Feeds and the ones in a
+ * registered format, are held whole until the end: the limit on the text
+ * size applies to all their contents
+ */
+static void
+stream_check_size (GrssFeedParserStream *stream)
+{
+	GError *error;
+
+	if (stream->done || stream->limits.max_text_size == 0 || stream->size <= stream->limits.max_text_size)
+		return;
+
+	if (stream->json != NULL || (stream->format != NULL && stream->format->handler == NULL)) {
+		error = NULL;
+		g_set_error (&error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_LIMIT_EXCEEDED, "Document exceeds the limit on text size");
+		stream_stop (stream, error);
+	}
+}
+
+/*
+ * At the first item the format of the document is checked, and the channel
+ * is parsed as far as it has been read
+ */
+static gboolean
+stream_begin (GrssFeedParserStream *stream, xmlDocPtr doc, xmlNodePtr item)
+{
+	GError *error;
+
+	error = NULL;
+	stream->format = init_parsing (stream->parser, doc, &error);
+
+	if (stream->format == NULL) {
+		stream_stop (stream, error);
+		return FALSE;
+	}
+
+	/* registered formats want the whole document */
+	if (stream->format->handler == NULL)
+		return FALSE;
+
+	init_context (stream->parser, stream->channel, &stream->context);
+	stream->context.foreach_func = stream->func;
+	stream->context.foreach_data = stream->user_data;
+	stream->context.deadline = 0;
+	stream->has_context = TRUE;
+
+	run_format (stream->format, stream->channel, doc, FALSE, &stream->context, &error);
+	if (error != NULL) {
+		stream_stop (stream, error);
+		return FALSE;
+	}
+
+	stream->prefix = item->prev;
+	return TRUE;
+}
+
+static void
+stream_element_closed (xmlNodePtr node, gpointer user_data)
+{
+	GError *error;
+	GrssFeedParserStream *stream;
+
+	stream = user_data;
+
+	if (stream->done || is_stream_item (node) == FALSE)
+		return;
+
+	if (stream->has_context == FALSE) {
+		if (stream->format != NULL || stream_begin (stream, node->doc, node) == FALSE)
+			return;
+	}
+
+	error = NULL;
+	stream->context.resume = node;
+	run_format (stream->format, stream->channel, node->doc, TRUE, &stream->context, &error);
+
+	xml_push_reader_drop (stream->reader, node);
+
+	/*
+	 * the cached base and namespaces may belong to the dropped element,
+	 * and the addresses of the latter be reused by the next ones
+	 */
+	stream->context.base_cached = FALSE;
+	stream->context.ns_cache.len = 0;
+
+	if (error != NULL || feed_parse_context_is_full (&stream->context))
+		stream_stop (stream, error);
+}
+
+/* ceiling of the memory used by a stream whose parser has no limits */
+#define STREAM_DEFAULT_MAX_NODES	100000
+#define STREAM_DEFAULT_MAX_TEXT_SIZE	(16 * 1024 * 1024)
+
+/**
+ * grss_feed_parser_stream_new:
+ * @parser: a #GrssFeedParser.
+ * @feed: the #GrssFeedChannel to be parsed.
+ * @content_type: (allow-none): the Content-Type of the document, if known.
+ * @func: function invoked for each item, until the stream is finished.
+ * @user_data: data to pass to @func.
+ *
+ * Begins the parsing of a document provided a chunk at a time with
+ * grss_feed_parser_stream_push(), usually while it is downloaded. As with
+ * grss_feed_parser_parse_foreach(), each item is passed to @func, in the
+ * same order it has into the document: this happens as soon as the item
+ * has been read, and then its portion of the document is released.
+ *
+ * So the memory used by the stream does not depend on the size of the
+ * document: the limits on the number of nodes and on the text size set
+ * with grss_feed_parser_set_limits() apply to the portion of the document
+ * held at once, i.e. the channel and a single item, and are the ceiling of
+ * the memory used. When they are not set, the stream enforces anyway a
+ * limit of 100000 nodes and 16 MB of text. The limit on the parse time does
+ * not apply, as the document arrives at the pace of the network.
+ *
+ * Items are passed to @func before the rest of the document is read: if it
+ * then turns out to be invalid, the error is reported anyway. When the
+ * parsing is stopped before the end of the document, the elements of the
+ * channel found after the last item are not parsed.
+ *
+ * Documents in the JSON Feed format, and in formats registered with
+ * grss_feed_parser_register_format(), are read in full before the parsing:
+ * for them the limit on the text size applies to the whole document, and
+ * a #GRSS_FEED_PARSER_LIMIT_EXCEEDED error is raised when it is exceeded.
+ *
+ * Returns: (transfer full): a new #GrssFeedParserStream, to be completed
+ * with grss_feed_parser_stream_finish() or released with
+ * grss_feed_parser_stream_free().
+ */
+GrssFeedParserStream*
+grss_feed_parser_stream_new (GrssFeedParser *parser, GrssFeedChannel *feed, const gchar *content_type,
+                             GrssFeedParserForeachFunc func, gpointer user_data)
+{
+	GrssFeedParserStream *stream;
+
+	g_return_val_if_fail (func != NULL, NULL);
+
+	stream = g_new0 (GrssFeedParserStream, 1);
+	stream->parser = g_object_ref (parser);
+	stream->channel = g_object_ref (feed);
+	stream->func = func;
+	stream->user_data = user_data;
+	stream->content_type = g_strdup (content_type);
+	stream->head = g_string_new (NULL);
+
+	stream->limits = parser->priv->limits;
+	stream->limits.max_parse_time = 0;
+
+	if (stream->limits.max_nodes == 0)
+		stream->limits.max_nodes = STREAM_DEFAULT_MAX_NODES;
+	if (stream->limits.max_text_size == 0)
+		stream->limits.max_text_size = STREAM_DEFAULT_MAX_TEXT_SIZE;
+
+	return stream;
+}
+
+static gboolean
+stream_read (GrssFeedParserStream *stream, const gchar *data, gsize size, gboolean last)
+{
+	gboolean ret;
+	gsize normal_size;
+	const gchar *normal;
+
+	stream->size += size;
+
+	if (stream->json != NULL) {
+		g_string_append_len (stream->json, data, size);
+		ret = TRUE;
+	}
+	else {
+		normal = charset_normalizer_feed (stream->normalizer, data, size, last, &normal_size);
+		ret = (xml_push_reader_feed (stream->reader, normal, normal_size) || stream->done);
+	}
+
+	if (ret)
+		stream_check_size (stream);
+
+	return ret;
+}
+
+/* once enough of the document has been collected, the reading begins */
+static gboolean
+stream_open (GrssFeedParserStream *stream, gboolean last, GError **error)
+{
+	gboolean ret;
+	gboolean json;
+	GString *head;
+
+	head = stream->head;
+	stream->head = NULL;
+
+	if (head->len == 0) {
+		g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Empty document!");
+		g_string_free (head, TRUE);
+		return FALSE;
+	}
+
+	json = is_json_document (head->str, head->len, stream->content_type);
+	stream->normalizer = charset_normalizer_new (head->str, head->len, stream->content_type, json == FALSE);
+
+	if (json) {
+		stream->json = head;
+		stream->size = head->len;
+		stream_check_size (stream);
+		return TRUE;
+	}
+
+	stream->reader = xml_push_reader_new (NULL, normalized_xml_options (stream->parser, stream->normalizer), &stream->limits);
+	if (stream->reader == NULL) {
+		g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Unable to parse document");
+		g_string_free (head, TRUE);
+		return FALSE;
+	}
+
+	xml_push_reader_set_element_func (stream->reader, stream_element_closed, stream);
+
+	ret = stream_read (stream, head->str, head->len, last);
+	g_string_free (head, TRUE);
+	return ret;
+}
+
+/* the reader reports why the document was rejected */
+static void
+stream_fail (GrssFeedParserStream *stream, GError **error)
+{
+	GError *err;
+	xmlDocPtr doc;
+
+	err = NULL;
+	doc = xml_push_reader_finish (stream->reader, &err);
+	stream->reader = NULL;
+	stream->done = TRUE;
+
+	if (doc != NULL)
+		xmlFreeDoc (doc);
+
+	if (err == NULL)
+		g_set_error (&err, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Unable to parse document");
+
+	g_propagate_error (error, err);
+}
+
+/**
+ * grss_feed_parser_stream_push:
+ * @stream: a #GrssFeedParserStream.
+ * @data: (array length=size): the next chunk of the document.
+ * @size: length of @data.
+ * @error: location for eventual errors.
+ *
+ * Reads another chunk of the document, passing to the foreach function the
+ * items completed within it.
+ *
+ * Returns: %TRUE if more contents are expected, %FALSE if the stream wants
+ * no more of them: this happens when an error occurs, and @error is set,
+ * or when the foreach function asks to stop or the maximum number of items
+ * has been reached. In any case, the stream has then to be finished.
+ */
+gboolean
+grss_feed_parser_stream_push (GrssFeedParserStream *stream, const gchar *data, gsize size, GError **error)
+{
+	if (stream->done)
+		return FALSE;
+
+	if (stream->head != NULL) {
+		g_string_append_len (stream->head, data, size);
+		if (stream->head->len < STREAM_HEAD_SIZE)
+			return TRUE;
+
+		if (stream_open (stream, FALSE, error) == FALSE) {
+			if (stream->reader != NULL)
+				stream_fail (stream, error);
+			stream->done = TRUE;
+			return FALSE;
+		}
+	}
+	else if (stream_read (stream, data, size, FALSE) == FALSE) {
+		stream_fail (stream, error);
+		return FALSE;
+	}
+
+	if (stream->error != NULL) {
+		g_propagate_error (error, stream->error);
+		stream->error = NULL;
+	}
+
+	return (stream->done == FALSE);
+}
+
+/* the channel elements already parsed when the first item was found */
+static void
+stream_drop_prefix (GrssFeedParserStream *stream)
+{
+	xmlNodePtr prev;
+
+	while (stream->prefix != NULL) {
+		prev = stream->prefix->prev;
+		xmlUnlinkNode (stream->prefix);
+		xmlFreeNode (stream->prefix);
+		stream->prefix = prev;
+	}
+}
+
+static void
+stream_complete (GrssFeedParserStream *stream, GError **error)
+{
+	gsize size;
+	const gchar *data;
+	xmlDocPtr doc;
+	FeedFormat *format;
+	FeedParseContext context;
+
+	if (stream->json != NULL) {
+		data = charset_normalizer_feed (stream->normalizer, stream->json->str, stream->json->len, TRUE, &size);
+
+		if (feed_json_handler_check_format (data, size, error)) {
+			init_context (stream->parser, stream->channel, &context);
+			context.valid_utf8 = charset_normalizer_is_utf8 (stream->normalizer);
+			context.foreach_func = stream->func;
+			context.foreach_data = stream->user_data;
+			context.deadline = 0;
+			run_json (stream->channel, data, size, TRUE, &context, error);
+			clear_context (&context);
+		}
+
+		return;
+	}
+
+	doc = xml_push_reader_finish (stream->reader, error);
+	stream->reader = NULL;
+
+	if (doc == NULL) {
+		if (*error == NULL)
+			g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Unable to parse document");
+		return;
+	}
+
+	if (stream->has_context) {
+		/* only the elements found after the first item are left */
+		stream_drop_prefix (stream);
+		run_format (stream->format, stream->channel, doc, FALSE, &stream->context, error);
+	}
+	else {
+		/* no item has been streamed, the document is parsed as usual */
+		format = stream->format;
+		if (format == NULL)
+			format = init_parsing (stream->parser, doc, error);
+
+		if (format != NULL) {
+			init_context (stream->parser, stream->channel, &context);
+			context.foreach_func = stream->func;
+			context.foreach_data = stream->user_data;
+			context.deadline = 0;
+			run_format (format, stream->channel, doc, TRUE, &context, error);
+			clear_context (&context);
+		}
+	}
+
+	xmlFreeDoc (doc);
+}
+
+/**
+ * grss_feed_parser_stream_finish:
+ * @stream: a #GrssFeedParserStream.
+ * @error: location for eventual errors.
+ *
+ * Completes the parsing of the document, once all its contents have been
+ * passed to grss_feed_parser_stream_push() or the stream asked to stop,
+ * and frees the @stream. The elements of the channel found after the items
+ * are parsed now.
+ *
+ * Returns: %FALSE if an error occurs and @error is set, %TRUE otherwise.
+ */
+gboolean
+grss_feed_parser_stream_finish (GrssFeedParserStream *stream, GError **error)
+{
+	GError *err;
+
+	err = NULL;
+
+	if (stream->done == FALSE) {
+		if (stream->head != NULL) {
+			if (stream_open (stream, TRUE, &err) == FALSE && stream->reader != NULL)
+				stream_fail (stream, &err);
+		}
+		else if (stream_read (stream, NULL, 0, TRUE) == FALSE) {
+			stream_fail (stream, &err);
+		}
+	}
+
+	if (err == NULL && stream->error != NULL) {
+		err = stream->error;
+		stream->error = NULL;
+	}
+
+	if (err == NULL && stream->done == FALSE)
+		stream_complete (stream, &err);
+
+	if (stream->normalizer != NULL)
+		report_encoding (stream->channel, stream->normalizer);
+
+	grss_feed_parser_stream_free (stream);
+
+	if (err != NULL) {
+		g_propagate_error (error, err);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * grss_feed_parser_stream_free:
+ * @stream: a #GrssFeedParserStream.
+ *
+ * Releases a @stream without completing the parsing, e.g. when the
+ * download of the document fails.
+ */
+void
+grss_feed_parser_stream_free (GrssFeedParserStream *stream)
+{
+	if (stream->reader != NULL)
+		xml_push_reader_free (stream->reader);
+
+	if (stream->normalizer != NULL)
+		charset_normalizer_free (stream->normalizer);
+
+	if (stream->has_context)
+		clear_context (&stream->context);
+
+	if (stream->head != NULL)
+		g_string_free (stream->head, TRUE);
+
+	if (stream->json != NULL)
+		g_string_free (stream->json, TRUE);
+
+	if (stream->error != NULL)
+		g_error_free (stream->error);
+
+	g_free (stream->content_type);
+	g_object_unref (stream->channel);
+	g_object_unref (stream->parser);
+	g_free (stream);
+}
+
+/**
+ * grss_feed_parser_set_lazy_content:
+ * @parser: a #GrssFeedParser.
+ * @lazy: %TRUE to defer the conversion of contents.
+ *
+ * If @lazy is %TRUE, the escaped HTML found in descriptions of the parsed
+ * items is not immediately converted to XHTML but kept as is, and converted
+ * only at the first call of grss_feed_item_get_description(). This saves
+ * most of the parsing time when many items are discarded without looking at
+ * their contents (e.g. because already known).
+ * By default this is %FALSE.
+ */
+void
+grss_feed_parser_set_lazy_content (GrssFeedParser *parser, gboolean lazy)
+{
+	parser->priv->lazy_content = lazy;
+}
+
+/**
+ * grss_feed_parser_get_lazy_content:
+ * @parser: a #GrssFeedParser.
+ *
+ * Retrieves the value set with grss_feed_parser_set_lazy_content().
+ *
+ * Returns: %TRUE if contents of items are converted on request.
+ */
+gboolean
+grss_feed_parser_get_lazy_content (GrssFeedParser *parser)
+{
+	return parser->priv->lazy_content;
+}
+
+
+/**
+ * grss_feed_parser_set_fields:
+ * @parser: a #GrssFeedParser.
+ * @fields: parts of the documents to parse.
+ *
+ * To skip the parts of items which are not required by the caller: elements
+ * (and namespaces) not included in @fields are ignored, and the related
+ * attributes of the #GrssFeedItem are left unset.
+ * By default this is #GRSS_FEED_PARSER_FIELDS_ALL.
+ */
+void
+grss_feed_parser_set_fields (GrssFeedParser *parser, GrssFeedParserFields fields)
+{
+	parser->priv->fields = fields;
+}
+
+/**
+ * grss_feed_parser_get_fields:
+ * @parser: a #GrssFeedParser.
+ *
+ * Retrieves the value set with grss_feed_parser_set_fields().
+ *
+ * Returns: parts of the documents parsed by the @parser.
+ */
+GrssFeedParserFields
+grss_feed_parser_get_fields (GrssFeedParser *parser)
+{
+	return parser->priv->fields;
+}
+
+/**
+ * grss_feed_parser_set_max_items:
+ * @parser: a #GrssFeedParser.
+ * @max_items: maximum number of items to parse, or 0 for no limit.
+ *
+ * To stop building items once @max_items have been found into the
+ * document: feeds usually list the most recent items first, and those
+ * holding their whole history may be parsed much faster. Items skipped with
+ * grss_feed_parser_set_seen_func() are not counted.
+ * By default there is no limit.
+ */
+void
+grss_feed_parser_set_max_items (GrssFeedParser *parser, guint max_items)
+{
+	parser->priv->max_items = max_items;
+}
+
+/**
+ * grss_feed_parser_get_max_items:
+ * @parser: a #GrssFeedParser.
+ *
+ * Retrieves the value set with grss_feed_parser_set_max_items().
+ *
+ * Returns: maximum number of items returned by grss_feed_parser_parse(), or
+ * 0 if there is no limit.
+ */
+guint
+grss_feed_parser_get_max_items (GrssFeedParser *parser)
+{
+	return parser->priv->max_items;
+}
+
+/**
+ * grss_feed_parser_set_xml_options:
+ * @parser: a #GrssFeedParser.
+ * @options: a combination of libxml2 #xmlParserOption.
+ *
+ * To set the options used to read the documents parsed by the @parser,
+ * when it is the @parser itself to read them (as in
+ * grss_feed_parser_parse_many() or when fetching a #GrssFeedChannel
+ * within a #GrssFeedsPool). Options as XML_PARSE_NOBLANKS or
+ * XML_PARSE_HUGE may be used to tune speed and memory usage on known
+ * sources. Default is %GRSS_FEED_PARSER_XML_OPTIONS_DEFAULT.
+ */
+void
+grss_feed_parser_set_xml_options (GrssFeedParser *parser, gint options)
+{
+	parser->priv->xml_options = options;
+}
+
+/**
+ * grss_feed_parser_get_xml_options:
+ * @parser: a #GrssFeedParser.
+ *
+ * Retrieves the value set with grss_feed_parser_set_xml_options().
+ *
+ * Returns: the libxml2 options used by @parser.
+ */
+gint
+grss_feed_parser_get_xml_options (GrssFeedParser *parser)
+{
+	return parser->priv->xml_options;
+}
+
+/**
+ * grss_feed_parser_set_limits:
+ * @parser: a #GrssFeedParser.
+ * @limits: (allow-none): the limits to enforce, or %NULL to remove all.
+ *
+ * To bound the resources spent on each document when it is the @parser
+ * itself to read it (as in grss_feed_parser_parse_many() or when fetching a
+ * #GrssFeedChannel within a #GrssFeedsPool), so that a broken or hostile
+ * feed cannot stall the application. When a limit is exceeded the document
+ * is discarded and a #GRSS_FEED_PARSER_LIMIT_EXCEEDED error is raised.
+ * The limit on time also applies to grss_feed_parser_parse() and
+ * grss_feed_parser_parse_records().
+ * In JSON Feed documents the nodes are objects and arrays, the text is the
+ * one of strings and numbers, and the limits on attributes and entities do
+ * not apply.
+ * By default there are no limits, apart the ones of libxml2 itself.
+ */
+void
+grss_feed_parser_set_limits (GrssFeedParser *parser, const GrssFeedParserLimits *limits)
+{
+	if (limits == NULL)
+		memset (&parser->priv->limits, 0, sizeof (GrssFeedParserLimits));
+	else
+		parser->priv->limits = *limits;
+}
+
+/**
+ * grss_feed_parser_get_limits:
+ * @parser: a #GrssFeedParser.
+ * @limits: (out caller-allocates): location to store the limits.
+ *
+ * Retrieves the values set with grss_feed_parser_set_limits().
+ */
+void
+grss_feed_parser_get_limits (GrssFeedParser *parser, GrssFeedParserLimits *limits)
+{
+	*limits = parser->priv->limits;
+}
+
+/**
+ * grss_feed_parser_set_seen_func:
+ * @parser: a #GrssFeedParser.
+ * @func: (allow-none): function to check if an item is already known, or
+ *        %NULL to parse all items.
+ * @user_data: data to pass to @func.
+ * @destroy: (allow-none): function to free @user_data when @func is
+ *           replaced or the @parser destroyed.
+ *
+ * Permits to skip the items already known by the caller, usually the ones
+ * saved after a previous fetch of the same feed. Before parsing an item the
+ * @parser looks for its ID into the document (the "guid" of RSS, the "id" of
+ * Atom) and, if @func returns %TRUE for it, the item is not parsed at all.
+ * Items whose ID cannot be guessed in advance are fully parsed and then
+ * checked with the final value of grss_feed_item_get_id().
+ * This way the cost of parsing a feed is proportional to the amount of new
+ * contents.
+ */
+void
+grss_feed_parser_set_seen_func (GrssFeedParser *parser, GrssFeedParserSeenFunc func, gpointer user_data, GDestroyNotify destroy)
+{
+	if (parser->priv->seen_destroy != NULL)
+		parser->priv->seen_destroy (parser->priv->seen_data);
+
+	parser->priv->seen_func = func;
+	parser->priv->seen_data = user_data;
+	parser->priv->seen_destroy = destroy;
+}
+
+/**
+ * grss_feed_parser_register_format:
+ * @parser: a #GrssFeedParser.
+ * @root_name: name of the root element of the documents in the new format.
+ * @ns_href: (allow-none): namespace of the root element, or %NULL to
+ *           accept any.
+ * @func: function parsing the documents.
+ * @user_data: data to pass to @func.
+ * @destroy: (allow-none): function to free @user_data when the @parser is
+ *           destroyed.
+ *
+ * Adds support for a new format to the @parser: documents whose root element
+ * is named @root_name (and, if not %NULL, is in the @ns_href namespace) are
+ * parsed with @func. Formats registered later are tried first, so the ones
+ * supported by the library (RSS, Atom and Pie) may also be overridden.
+ * The items returned by @func are filtered according to
+ * grss_feed_parser_set_seen_func() and grss_feed_parser_set_max_items().
+ *
+ * This is not thread safe: formats have to be registered before using the
+ * @parser.
+ */
+void
+grss_feed_parser_register_format (GrssFeedParser *parser, const gchar *root_name, const gchar *ns_href,
+                                  GrssFeedParserFormatFunc func, gpointer user_data, GDestroyNotify destroy)
+{
+	FeedFormat *format;
+
+	g_return_if_fail (root_name != NULL);
+	g_return_if_fail (func != NULL);
+
+	format = add_format (parser, root_name, ns_href);
+	format->func = func;
+	format->user_data = user_data;
+	format->destroy = destroy;
+}
+
+/**
+ * grss_feed_parser_register_namespace:
+ * @parser: a #GrssFeedParser.
+ * @prefix: (allow-none): usual prefix of the namespace, used when the
+ *          document does not declare a known @href.
+ * @href: (allow-none): URI of the namespace.
+ * @channel_func: (allow-none): function handling the elements of the
+ *                namespace found within the channel, or %NULL.
+ * @item_func: (allow-none): function handling the elements of the namespace
+ *             found within the items, or %NULL.
+ * @user_data: data to pass to @channel_func and @item_func.
+ * @destroy: (allow-none): function to free @user_data when the @parser is
+ *           destroyed.
+ *
+ * Adds support for an extension namespace to all the formats handled by the
+ * @parser, replacing the built-in handling of the same namespace if any.
+ * Elements of the namespace are parsed only if
+ * #GRSS_FEED_PARSER_MODULE_OTHER is included in the value set with
+ * grss_feed_parser_set_fields().
+ *
+ * This is not thread safe: namespaces have to be registered before using the
+ * @parser.
+ */
+void
+grss_feed_parser_register_namespace (GrssFeedParser *parser, const gchar *prefix, const gchar *href,
+                                     GrssFeedParserChannelNsFunc channel_func, GrssFeedParserItemNsFunc item_func,
+                                     gpointer user_data, GDestroyNotify destroy)
+{
+	g_return_if_fail (prefix != NULL || href != NULL);
+
+	ns_handler_register (parser->priv->ns_handler, prefix, href, channel_func, item_func, user_data, destroy);
+}
@@ -42,11 +42,240 @@ typedef struct {
 	GObjectClass parent;
 } GrssFeedParserClass;
 
+/**
+ * GRSS_FEED_PARSER_ERROR:
+ *
+ * Error domain of the errors raised by #GrssFeedParser. Errors in this
+ * domain are from the #GrssFeedParserError enumeration.
+ */
+#define GRSS_FEED_PARSER_ERROR		(grss_feed_parser_error_quark ())
+
+/**
+ * GrssFeedParserError:
+ * @GRSS_FEED_PARSER_PARSE_ERROR: the document is not valid XML.
+ * @GRSS_FEED_PARSER_FORMAT_ERROR: the format of the document is unknown.
+ * @GRSS_FEED_PARSER_LIMIT_EXCEEDED: the document exceeds one of the limits
+ *                                   set with grss_feed_parser_set_limits().
+ *
+ * Errors raised by #GrssFeedParser.
+ */
+typedef enum {
+	GRSS_FEED_PARSER_PARSE_ERROR,
+	GRSS_FEED_PARSER_FORMAT_ERROR,
+	GRSS_FEED_PARSER_LIMIT_EXCEEDED
+} GrssFeedParserError;
+
+/**
+ * GrssFeedParserLimits:
+ * @max_depth: maximum nesting depth of elements.
+ * @max_nodes: maximum number of elements in the document.
+ * @max_attributes: maximum number of attributes of a single element.
+ * @max_text_size: maximum amount of text in the document, in bytes.
+ * @max_entities: maximum number of references to entities declared by the
+ *                document.
+ * @max_parse_time: maximum time spent reading the document, and then
+ *                  building its items, in milliseconds.
+ *
+ * Limits enforced by a #GrssFeedParser on the documents it reads, as set
+ * with grss_feed_parser_set_limits(). A limit of 0 means no limit.
+ */
+typedef struct {
+	guint	max_depth;
+	guint	max_nodes;
+	guint	max_attributes;
+	gsize	max_text_size;
+	guint	max_entities;
+	guint	max_parse_time;
+} GrssFeedParserLimits;
+
+/**
+ * GrssFeedParserFields:
+ * @GRSS_FEED_PARSER_FIELD_TITLE: title of items.
+ * @GRSS_FEED_PARSER_FIELD_DESCRIPTION: description and contents of items.
+ * @GRSS_FEED_PARSER_FIELD_AUTHORS: authors and contributors of items.
+ * @GRSS_FEED_PARSER_FIELD_CATEGORIES: categories of items.
+ * @GRSS_FEED_PARSER_FIELD_ENCLOSURES: enclosures of RSS items.
+ * @GRSS_FEED_PARSER_FIELD_COMMENTS: comments URL of items.
+ * @GRSS_FEED_PARSER_FIELD_RIGHTS: copyright of items.
+ * @GRSS_FEED_PARSER_FIELD_REAL_SOURCE: original source of items.
+ * @GRSS_FEED_PARSER_MODULE_CONTENT: the "content" namespace.
+ * @GRSS_FEED_PARSER_MODULE_DC: the Dublin Core namespace (dc:date of items
+ *                              is parsed anyway).
+ * @GRSS_FEED_PARSER_MODULE_GEO: the "geo" and "georss" namespaces.
+ * @GRSS_FEED_PARSER_MODULE_ITUNES: the iTunes namespace.
+ * @GRSS_FEED_PARSER_MODULE_MEDIA: the Media RSS namespace.
+ * @GRSS_FEED_PARSER_MODULE_OTHER: all other supported namespaces.
+ * @GRSS_FEED_PARSER_FIELDS_ALL: everything.
+ *
+ * Parts of the documents to be parsed by a #GrssFeedParser, as set with
+ * grss_feed_parser_set_fields(). ID, link and dates of items are always
+ * parsed, as the channel, namespaced elements of the channel included.
+ */
+typedef enum {
+	GRSS_FEED_PARSER_FIELD_TITLE		= 1 << 0,
+	GRSS_FEED_PARSER_FIELD_DESCRIPTION	= 1 << 1,
+	GRSS_FEED_PARSER_FIELD_AUTHORS		= 1 << 2,
+	GRSS_FEED_PARSER_FIELD_CATEGORIES	= 1 << 3,
+	GRSS_FEED_PARSER_FIELD_ENCLOSURES	= 1 << 4,
+	GRSS_FEED_PARSER_FIELD_COMMENTS		= 1 << 5,
+	GRSS_FEED_PARSER_FIELD_RIGHTS		= 1 << 6,
+	GRSS_FEED_PARSER_FIELD_REAL_SOURCE	= 1 << 7,
+
+	GRSS_FEED_PARSER_MODULE_CONTENT		= 1 << 16,
+	GRSS_FEED_PARSER_MODULE_DC		= 1 << 17,
+	GRSS_FEED_PARSER_MODULE_GEO		= 1 << 18,
+	GRSS_FEED_PARSER_MODULE_ITUNES		= 1 << 19,
+	GRSS_FEED_PARSER_MODULE_MEDIA		= 1 << 20,
+	GRSS_FEED_PARSER_MODULE_OTHER		= 1 << 21,
+
+	GRSS_FEED_PARSER_FIELDS_ALL		= 0x003F00FF
+} GrssFeedParserFields;
+
+/**
+ * GrssFeedParserResult:
+ * @channel: the #GrssFeedChannel built from the document, or %NULL if it
+ *           was not possible to parse it.
+ * @items: (element-type GrssFeedItem): the items found in the document.
+ * @error: the error occurred parsing the document, or %NULL.
+ *
+ * The outcome of the parsing of a single document with
+ * grss_feed_parser_parse_many().
+ */
+typedef struct {
+	GrssFeedChannel	*channel;
+	GList		*items;
+	GError		*error;
+} GrssFeedParserResult;
+
+/**
+ * GrssFeedParserSeenFunc:
+ * @channel: the #GrssFeedChannel being parsed.
+ * @id: ID of an item found into the document.
+ * @user_data: data passed to grss_feed_parser_set_seen_func().
+ *
+ * Used to check if an item is already known to the caller of the parser.
+ *
+ * Returns: %TRUE if the item with the given @id has not to be parsed.
+ */
+typedef gboolean (*GrssFeedParserSeenFunc) (GrssFeedChannel *channel, const gchar *id, gpointer user_data);
+
+/**
+ * GrssFeedParserForeachFunc:
+ * @channel: the #GrssFeedChannel being parsed.
+ * @item: an item just parsed from the document.
+ * @user_data: data passed to grss_feed_parser_parse_foreach() or
+ *             grss_feed_parser_stream_new().
+ *
+ * Receives the items parsed by grss_feed_parser_parse_foreach() or by a
+ * #GrssFeedParserStream, one at a time. The @item is released after the call: to keep it, add a reference
+ * with g_object_ref().
+ *
+ * Returns: %TRUE to continue the parsing, %FALSE to stop it.
+ */
+typedef gboolean (*GrssFeedParserForeachFunc) (GrssFeedChannel *channel, GrssFeedItem *item, gpointer user_data);
+
+/**
+ * GrssFeedParserStream:
+ *
+ * Opaque structure for the parsing of a document read a chunk at a time,
+ * created with grss_feed_parser_stream_new().
+ */
+typedef struct _GrssFeedParserStream	GrssFeedParserStream;
+
+/**
+ * GrssFeedParserFormatFunc:
+ * @channel: the #GrssFeedChannel being parsed.
+ * @doc: the XML document to parse.
+ * @do_items: %FALSE if only the attributes of @channel are required.
+ * @user_data: data passed to grss_feed_parser_register_format().
+ * @error: location for eventual errors.
+ *
+ * Parses a document in a format registered with
+ * grss_feed_parser_register_format(), filling the @channel.
+ *
+ * Returns: (element-type GrssFeedItem) (transfer full): the items found in
+ * @doc, in the same order, or %NULL if @do_items is %FALSE.
+ */
+typedef GList* (*GrssFeedParserFormatFunc) (GrssFeedChannel *channel, xmlDocPtr doc, gboolean do_items, gpointer user_data, GError **error);
+
+/**
+ * GrssFeedParserChannelNsFunc:
+ * @channel: the #GrssFeedChannel being parsed.
+ * @cur: an element of the channel in the registered namespace.
+ * @user_data: data passed to grss_feed_parser_register_namespace().
+ *
+ * Handles an element of a namespace registered with
+ * grss_feed_parser_register_namespace(), found within the channel.
+ *
+ * Returns: %TRUE if @cur has been consumed, %FALSE to let the format
+ * handler parse it.
+ */
+typedef gboolean (*GrssFeedParserChannelNsFunc) (GrssFeedChannel *channel, xmlNodePtr cur, gpointer user_data);
+
+/**
+ * GrssFeedParserItemNsFunc:
+ * @item: the #GrssFeedItem being parsed.
+ * @cur: an element of the item in the registered namespace.
+ * @user_data: data passed to grss_feed_parser_register_namespace().
+ *
+ * Handles an element of a namespace registered with
+ * grss_feed_parser_register_namespace(), found within an item.
+ */
+typedef void (*GrssFeedParserItemNsFunc) (GrssFeedItem *item, xmlNodePtr cur, gpointer user_data);
+
+/**
+ * GRSS_FEED_PARSER_XML_OPTIONS_DEFAULT:
+ *
+ * Default set of libxml2 #xmlParserOption used to read the documents
+ * fetched or loaded by the library. See grss_feed_parser_set_xml_options().
+ */
+#define GRSS_FEED_PARSER_XML_OPTIONS_DEFAULT	(XML_PARSE_COMPACT)
+
 GType		grss_feed_parser_get_type	() G_GNUC_CONST;
+GQuark		grss_feed_parser_error_quark	() G_GNUC_CONST;
 
 GrssFeedParser*	grss_feed_parser_new		();
 
 GList*		grss_feed_parser_parse		(GrssFeedParser *parser, GrssFeedChannel *feed, xmlDocPtr doc, GError **error);
 void		grss_feed_parser_parse_channel	(GrssFeedParser *parser, GrssFeedChannel *feed, xmlDocPtr doc, GError **error);
+GPtrArray*	grss_feed_parser_parse_records	(GrssFeedParser *parser, GrssFeedChannel *feed, xmlDocPtr doc, GError **error);
+gboolean	grss_feed_parser_parse_foreach	(GrssFeedParser *parser, GrssFeedChannel *feed, xmlDocPtr doc,
+						 GrssFeedParserForeachFunc func, gpointer user_data, GError **error);
+GList*		grss_feed_parser_parse_data	(GrssFeedParser *parser, GrssFeedChannel *feed, const gchar *data, gsize size, GError **error);
+GPtrArray*	grss_feed_parser_parse_many	(GrssFeedParser *parser, const gchar **paths, GBytes **buffers, guint threads);
+
+GType			grss_feed_parser_result_get_type	() G_GNUC_CONST;
+GrssFeedParserResult*	grss_feed_parser_result_copy		(GrssFeedParserResult *result);
+void			grss_feed_parser_result_free		(GrssFeedParserResult *result);
+
+GrssFeedParserStream*	grss_feed_parser_stream_new	(GrssFeedParser *parser, GrssFeedChannel *feed, const gchar *content_type,
+							 GrssFeedParserForeachFunc func, gpointer user_data);
+gboolean		grss_feed_parser_stream_push	(GrssFeedParserStream *stream, const gchar *data, gsize size, GError **error);
+gboolean		grss_feed_parser_stream_finish	(GrssFeedParserStream *stream, GError **error);
+void			grss_feed_parser_stream_free	(GrssFeedParserStream *stream);
+
+/* here, as they depend on the types of the parser */
+void		grss_feed_channel_fetch_foreach_async	(GrssFeedChannel *channel, GrssFeedParser *parser,
+							 GrssFeedParserForeachFunc func, gpointer func_data,
+							 GAsyncReadyCallback callback, gpointer user_data);
+gboolean	grss_feed_channel_fetch_foreach_finish	(GrssFeedChannel *channel, GAsyncResult *res, GError **error);
+
+void		grss_feed_parser_set_lazy_content	(GrssFeedParser *parser, gboolean lazy);
+gboolean	grss_feed_parser_get_lazy_content	(GrssFeedParser *parser);
+void		grss_feed_parser_set_fields		(GrssFeedParser *parser, GrssFeedParserFields fields);
+GrssFeedParserFields grss_feed_parser_get_fields		(GrssFeedParser *parser);
+void		grss_feed_parser_set_max_items		(GrssFeedParser *parser, guint max_items);
+guint		grss_feed_parser_get_max_items		(GrssFeedParser *parser);
+void		grss_feed_parser_set_xml_options	(GrssFeedParser *parser, gint options);
+gint		grss_feed_parser_get_xml_options	(GrssFeedParser *parser);
+void		grss_feed_parser_set_limits		(GrssFeedParser *parser, const GrssFeedParserLimits *limits);
+void		grss_feed_parser_get_limits		(GrssFeedParser *parser, GrssFeedParserLimits *limits);
+void		grss_feed_parser_set_seen_func		(GrssFeedParser *parser, GrssFeedParserSeenFunc func, gpointer user_data, GDestroyNotify destroy);
+
+void		grss_feed_parser_register_format	(GrssFeedParser *parser, const gchar *root_name, const gchar *ns_href,
+							 GrssFeedParserFormatFunc func, gpointer user_data, GDestroyNotify destroy);
+void		grss_feed_parser_register_namespace	(GrssFeedParser *parser, const gchar *prefix, const gchar *href,
+							 GrssFeedParserChannelNsFunc channel_func, GrssFeedParserItemNsFunc item_func,
+							 gpointer user_data, GDestroyNotify destroy);
 
 #endif /* __FEED_PARSER_H__ */
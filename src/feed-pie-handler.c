@@ -31,6 +31,7 @@
 #include "utils.h"
 #include "feed-channel.h"
 #include "feed-item.h"
+#include "feed-item-private.h"
 #include "feed-enclosure.h"
 #include "ns-handler.h"
 
@@ -74,13 +75,13 @@ feed_pie_handler_set_ns_handler (FeedHandler *self, NSHandler *handler)
 	pie->priv->handler = handler;
 }
 
-static gboolean
-feed_pie_handler_check_format (FeedHandler *self, xmlDocPtr doc, xmlNodePtr cur)
+static const gchar**
+feed_pie_handler_get_roots (FeedHandler *self)
 {
-	if (!xmlStrcmp (cur->name, BAD_CAST "feed"))
-		return TRUE;
-	else
-		return FALSE;
+	/* any namespace: Atom 1.0 is recognized first, see feed-parser.c */
+	static const gchar *roots [] = {"feed", NULL};
+
+	return roots;
 }
 
 static gchar*
@@ -194,8 +195,63 @@ parseAuthor (xmlNodePtr cur) {
 	return person;
 }
 
+/*
+ * Escaped HTML may be converted only when required, see
+ * grss_feed_item_set_description_from_node(). Everything else is handled by
+ * pie_parse_content_construct()
+ */
+static void
+pie_parse_item_description (GrssFeedItem *item, xmlNodePtr cur)
+{
+	gchar *mode;
+	gchar *type;
+	gchar *tmp;
+
+	mode = (gchar*) xmlGetProp (cur, BAD_CAST"mode");
+	type = (gchar*) xmlGetProp (cur, BAD_CAST"type");
+
+	if (mode != NULL && !strcmp (mode, "escaped")) {
+		grss_feed_item_set_description_from_node (item, cur, NULL);
+	}
+	else if (mode == NULL && type != NULL && (!g_ascii_strcasecmp (type, "HTML") || !strcmp (type, "text/html"))) {
+		grss_feed_item_set_description_from_node (item, cur, "http://default.base.com/");
+	}
+	else if (NULL != (tmp = pie_parse_content_construct (cur))) {
+		grss_feed_item_set_description_take (item, tmp);
+	}
+
+	g_free (mode);
+	g_free (type);
+}
+
+/* the last <id> wins, as in parse_entry() */
+static gchar*
+peek_entry_id (FeedHandler *self, FeedParseContext *context, xmlNodePtr cur)
+{
+	gchar *tmp;
+	gchar *ret;
+	FeedPieHandler *parser;
+
+	parser = FEED_PIE_HANDLER (self);
+	ret = NULL;
+
+	for (cur = cur->xmlChildrenNode; cur; cur = cur->next) {
+		if (ns_handler_handles_item (parser->priv->handler, &context->ns_cache, cur))
+			continue;
+
+		if (cur->name && !xmlStrcmp (cur->name, BAD_CAST"id")) {
+			if (NULL != (tmp = (gchar*) xmlNodeListGetString (cur->doc, cur->xmlChildrenNode, 1))) {
+				g_free (ret);
+				ret = tmp;
+			}
+		}
+	}
+
+	return ret;
+}
+
 GrssFeedItem*
-parse_entry (FeedPieHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNodePtr cur) {
+parse_entry (FeedPieHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNodePtr cur, FeedParseContext *context) {
 	xmlChar *xtmp;
 	gchar *tmp2;
 	gchar *tmp;
@@ -203,7 +259,12 @@ parse_entry (FeedPieHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNo
 	GrssFeedItem *item;
 
 	g_assert (NULL != cur);
-	item = grss_feed_item_new (feed);
+
+	if (feed_parse_context_is_full (context) ||
+	    feed_parse_context_skip_node (context, FEED_HANDLER (parser), feed, cur, peek_entry_id))
+		return NULL;
+
+	item = feed_parse_context_new_item (context, feed, cur);
 
 	cur = cur->xmlChildrenNode;
 
@@ -215,7 +276,7 @@ parse_entry (FeedPieHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNo
 		}
 
 		if (cur->ns) {
-			if (ns_handler_item (parser->priv->handler, item, cur)) {
+			if (ns_handler_item (parser->priv->handler, &context->ns_cache, item, cur, context->fields)) {
 				cur = cur->next;
 				continue;
 			}
@@ -223,8 +284,7 @@ parse_entry (FeedPieHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNo
 
 		if (!xmlStrcmp (cur->name, BAD_CAST"title")) {
 			if (NULL != (tmp = unhtmlize (pie_parse_content_construct (cur)))) {
-				grss_feed_item_set_title (item, tmp);
-				g_free (tmp);
+				grss_feed_item_set_title_take (item, tmp);
 			}
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"link")) {
@@ -243,8 +303,7 @@ parse_entry (FeedPieHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNo
 			else {
 				/* 0.2 link : element content is the link, or non-alternate link in 0.3 */
 				if (NULL != (tmp = (gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, 1))) {
-					grss_feed_item_set_source (item, tmp);
-					g_free (tmp);
+					grss_feed_item_set_source_take (item, tmp);
 				}
 			}
 		}
@@ -262,8 +321,7 @@ parse_entry (FeedPieHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNo
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"id")) {
 			if (NULL != (tmp = (gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, 1))) {
-				grss_feed_item_set_id (item, tmp);
-				g_free (tmp);
+				grss_feed_item_set_id_take (item, tmp);
 			}
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"issued")) {
@@ -275,25 +333,17 @@ parse_entry (FeedPieHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNo
 		}
 		else if (!xmlStrcmp(cur->name, BAD_CAST"content")) {
 			/* <content> support */
-			if (NULL != (tmp = pie_parse_content_construct (cur))) {
-				grss_feed_item_set_description (item, tmp);
-				g_free (tmp);
-			}
+			pie_parse_item_description (item, cur);
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"summary")) {
 			/* <summary> can be used for short text descriptions, if there is no
 			   <content> description we show the <summary> content */
-			if (!grss_feed_item_get_description (item)) {
-				if (NULL != (tmp = pie_parse_content_construct (cur))) {
-					grss_feed_item_set_description (item, tmp);
-					g_free (tmp);
-				}
-			}
+			if (!grss_feed_item_has_description (item))
+				pie_parse_item_description (item, cur);
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"copyright")) {
  			if (NULL != (tmp = (gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, 1))) {
-				grss_feed_item_set_copyright (item, tmp);
-				g_free (tmp);
+				grss_feed_item_set_copyright_take (item, tmp);
 			}
 		}
 
@@ -304,7 +354,7 @@ parse_entry (FeedPieHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNo
 }
 
 static GList*
-feed_pie_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, GError **error)
+feed_pie_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, FeedParseContext *context, GError **error)
 {
 	gchar *tmp2;
 	gchar *tmp = NULL;
@@ -326,21 +376,29 @@ feed_pie_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc,
 		cur = cur->next;
 
 	while (TRUE) {
-		if (!cur || xmlStrcmp (cur->name, BAD_CAST"feed")) {
+		if (context->resume != NULL) {
+			/* a parsing split in slices continues from where it stopped */
+			cur = feed_parse_context_resume (context);
+		}
+		else if (!cur || xmlStrcmp (cur->name, BAD_CAST"feed")) {
 			g_set_error (error, FEED_PIE_HANDLER_ERROR, FEED_PIE_HANDLER_PARSE_ERROR, "Could not find Atom/PIE header!");
 			break;
 		}
-
-		/* parse feed contents */
-		cur = cur->xmlChildrenNode;
+		else {
+			/* parse feed contents */
+			cur = cur->xmlChildrenNode;
+		}
 		while (cur) {
 			if(!cur->name || cur->type != XML_ELEMENT_NODE) {
 				cur = cur->next;
 				continue;
 			}
 
+			if (do_items == TRUE && feed_parse_context_yield (context, cur))
+				break;
+
 			if (cur->ns) {
-				if (ns_handler_channel (parser->priv->handler, feed, cur)) {
+				if (ns_handler_channel (parser->priv->handler, &context->ns_cache, feed, cur)) {
 					cur = cur->next;
 					continue;
 				}
@@ -369,10 +427,8 @@ feed_pie_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc,
 				else {
 					/* 0.2 link : element content is the link, or non-alternate link in 0.3 */
 					tmp = (gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, 1);
-					if (tmp) {
-						grss_feed_channel_set_homepage (feed, tmp);
-						g_free (tmp);
-					}
+					if (tmp)
+						grss_feed_channel_set_homepage_take (feed, tmp);
 				}
 			}
 			/* parse feed author */
@@ -386,10 +442,8 @@ feed_pie_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc,
 			}
 			else if (!xmlStrcmp (cur->name, BAD_CAST"tagline")) {
 				tmp = pie_parse_content_construct (cur);
-				if (tmp) {
-					grss_feed_channel_set_description (feed, tmp);
-					g_free (tmp);
-				}
+				if (tmp)
+					grss_feed_channel_set_description_take (feed, tmp);
 			}
 			else if (!xmlStrcmp (cur->name, BAD_CAST"generator")) {
 				tmp = unhtmlize ((gchar*) xmlNodeListGetString(doc, cur->xmlChildrenNode, 1));
@@ -417,10 +471,8 @@ feed_pie_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc,
 			}
 			else if (!xmlStrcmp (cur->name, BAD_CAST"copyright")) {
 				tmp = pie_parse_content_construct (cur);
-				if (tmp) {
-					grss_feed_channel_set_copyright (feed, tmp);
-					g_free (tmp);
-				}
+				if (tmp)
+					grss_feed_channel_set_copyright_take (feed, tmp);
 			}
 			else if (!xmlStrcmp (cur->name, BAD_CAST"modified")) { /* Modified was last used in IETF draft 02) */
 				tmp = (gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, 1);
@@ -446,12 +498,9 @@ feed_pie_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc,
 				}
 			}
 			else if (do_items == TRUE && (!xmlStrcmp (cur->name, BAD_CAST"entry"))) {
-				item = parse_entry (parser, feed, doc, cur);
-				if (item) {
-					if (grss_feed_item_get_publish_time (item) == 0)
-						grss_feed_item_set_publish_time (item, now);
+				item = parse_entry (parser, feed, doc, cur, context);
+				if (item && feed_parse_context_collect_item (context, feed, item, now))
 					items = g_list_prepend (items, item);
-				}
 			}
 
 			cur = cur->next;
@@ -474,7 +523,7 @@ static void
 feed_handler_interface_init (FeedHandlerInterface *iface)
 {
 	iface->set_ns_handler = feed_pie_handler_set_ns_handler;
-	iface->check_format = feed_pie_handler_check_format;
+	iface->get_roots = feed_pie_handler_get_roots;
 	iface->parse = feed_pie_handler_parse;
 }
 
@@ -40,6 +40,7 @@
 #include "utils.h"
 #include "feed-channel.h"
 #include "feed-item.h"
+#include "feed-item-private.h"
 #include "feed-enclosure.h"
 #include "ns-handler.h"
 
@@ -87,24 +88,13 @@ feed_rss_handler_set_ns_handler (FeedHandler *self, NSHandler *handler)
 	rss->priv->handler = handler;
 }
 
-static gboolean
-feed_rss_handler_check_format (FeedHandler *self, xmlDocPtr doc, xmlNodePtr cur)
+static const gchar**
+feed_rss_handler_get_roots (FeedHandler *self)
 {
-	if (!xmlStrcmp (cur->name, BAD_CAST"rss") ||
-	    !xmlStrcmp (cur->name, BAD_CAST"rdf") ||
-	    !xmlStrcmp (cur->name, BAD_CAST"RDF")) {
-		return TRUE;
-	}
-
-	/* RSS 1.1 */
-	if ((NULL != cur->ns) &&
-	    (NULL != cur->ns->href) &&
-	    !xmlStrcmp (cur->name, BAD_CAST"Channel") &&
-	    !xmlStrcmp (cur->ns->href, BAD_CAST"http://purl.org/net/rss1.1#")) {
-	   	return TRUE;
-	}
+	/* RSS 0.9x and 2.0, RSS 1.0 and RSS 1.1 */
+	static const gchar *roots [] = {"rss", "rdf", "RDF", "Channel|http://purl.org/net/rss1.1#", NULL};
 
-	return FALSE;
+	return roots;
 }
 
 static void
@@ -134,7 +124,7 @@ parse_rss_cloud (GrssFeedChannel *feed, xmlNodePtr cur) {
 }
 
 static void
-parse_channel (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNodePtr cur) {
+parse_channel (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNodePtr cur, FeedParseContext *context) {
 	gchar *tmp;
 	time_t t;
 
@@ -149,7 +139,7 @@ parse_channel (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xml
 
 		/* check namespace of this tag */
 		if (cur->ns) {
-			if (ns_handler_channel (parser->priv->handler, feed, cur)) {
+			if (ns_handler_channel (parser->priv->handler, &context->ns_cache, feed, cur)) {
 				cur = cur->next;
 				continue;
 			}
@@ -157,10 +147,8 @@ parse_channel (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xml
 
 		if (!xmlStrcmp (cur->name, BAD_CAST"copyright")) {
  			tmp = (gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, 1);
-			if (tmp) {
-				grss_feed_channel_set_copyright (feed, tmp);
-				g_free (tmp);
-			}
+			if (tmp)
+				grss_feed_channel_set_copyright_take (feed, tmp);
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"webMaster") || !xmlStrcmp (cur->name, BAD_CAST"publisher")) {
  			tmp = (gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, 1);
@@ -217,8 +205,7 @@ parse_channel (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xml
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"title")) {
  			if (NULL != (tmp = unhtmlize ((gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, TRUE)))) {
-				grss_feed_channel_set_title (feed, tmp);
-				g_free (tmp);
+				grss_feed_channel_set_title_take (feed, tmp);
 			}
 		}
 		/*
@@ -226,16 +213,13 @@ parse_channel (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xml
 		*/
 		else if (!xmlStrcmp (cur->name, BAD_CAST"link") || !xmlStrcmp (cur->name, BAD_CAST"alink")) {
  			if (NULL != (tmp = unhtmlize ((gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, TRUE)))) {
-				grss_feed_channel_set_homepage (feed, tmp);
-				g_free (tmp);
+				grss_feed_channel_set_homepage_take (feed, tmp);
 			}
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"description")) {
 			tmp = (gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, TRUE);
-			if (tmp) {
-				grss_feed_channel_set_description (feed, tmp);
-				g_free (tmp);
-			}
+			if (tmp)
+				grss_feed_channel_set_description_take (feed, tmp);
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"cloud")) {
  			parse_rss_cloud (feed, cur);
@@ -245,8 +229,81 @@ parse_channel (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xml
 	}
 }
 
+/*
+ * Replicates the way parse_rss_item() assigns the ID: the "about" attribute,
+ * else the first not empty "guid" if no valid "link" has been found before,
+ * else the last valid "link"
+ */
+static gchar*
+peek_rss_item_id (FeedHandler *self, FeedParseContext *context, xmlNodePtr cur)
+{
+	gchar *tmp;
+	gchar *source;
+	FeedRssHandler *parser;
+
+	tmp = (gchar*) xmlGetProp (cur, BAD_CAST"about");
+	if (tmp)
+		return tmp;
+
+	parser = FEED_RSS_HANDLER (self);
+	source = NULL;
+
+	for (cur = cur->xmlChildrenNode; cur; cur = cur->next) {
+		if (cur->type != XML_ELEMENT_NODE || !cur->name)
+			continue;
+
+		if (ns_handler_handles_item (parser->priv->handler, &context->ns_cache, cur))
+			continue;
+
+		if (!xmlStrcmp (cur->name, BAD_CAST"link")) {
+ 			tmp = unhtmlize ((gchar*) xmlNodeListGetString (cur->doc, cur->xmlChildrenNode, TRUE));
+			if (tmp) {
+				g_free (source);
+				source = NULL;
+
+				if (test_url (tmp))
+					source = tmp;
+				else
+					g_free (tmp);
+			}
+		}
+		else if (source == NULL && !xmlStrcmp (cur->name, BAD_CAST"guid")) {
+			tmp = (gchar*) xmlNodeListGetString (cur->doc, cur->xmlChildrenNode, 1);
+			if (tmp) {
+				if (strlen (tmp) > 0)
+					return tmp;
+				xmlFree (tmp);
+			}
+		}
+	}
+
+	return source;
+}
+
+/* the field of the parser provided by an element of an item */
+static GrssFeedParserFields
+rss_item_element_field (const xmlChar *name)
+{
+	if (!xmlStrcmp (name, BAD_CAST"title"))
+		return GRSS_FEED_PARSER_FIELD_TITLE;
+	else if (!xmlStrcmp (name, BAD_CAST"description"))
+		return GRSS_FEED_PARSER_FIELD_DESCRIPTION;
+	else if (!xmlStrcmp (name, BAD_CAST"author"))
+		return GRSS_FEED_PARSER_FIELD_AUTHORS;
+	else if (!xmlStrcmp (name, BAD_CAST"category"))
+		return GRSS_FEED_PARSER_FIELD_CATEGORIES;
+	else if (!xmlStrcmp (name, BAD_CAST"enclosure"))
+		return GRSS_FEED_PARSER_FIELD_ENCLOSURES;
+	else if (!xmlStrcmp (name, BAD_CAST"comments"))
+		return GRSS_FEED_PARSER_FIELD_COMMENTS;
+	else if (!xmlStrcmp (name, BAD_CAST"source"))
+		return GRSS_FEED_PARSER_FIELD_REAL_SOURCE;
+	else
+		return 0;
+}
+
 static GrssFeedItem*
-parse_rss_item (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNodePtr cur)
+parse_rss_item (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xmlNodePtr cur, FeedParseContext *context)
 {
 	gchar *tmp;
 	gchar *tmp2;
@@ -256,14 +313,17 @@ parse_rss_item (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xm
 
 	g_assert (cur != NULL);
 
-	item = grss_feed_item_new (feed);
+	if (feed_parse_context_is_full (context) ||
+	    feed_parse_context_skip_node (context, FEED_HANDLER (parser), feed, cur, peek_rss_item_id))
+		return NULL;
+
+	item = feed_parse_context_new_item (context, feed, cur);
 
 	/* try to get an item about id */
 	tmp = (gchar*) xmlGetProp (cur, BAD_CAST"about");
 	if (tmp) {
 		grss_feed_item_set_id (item, tmp);
-		grss_feed_item_set_source (item, tmp);
-		g_free (tmp);
+		grss_feed_item_set_source_take (item, tmp);
 	}
 
 	cur = cur->xmlChildrenNode;
@@ -276,12 +336,18 @@ parse_rss_item (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xm
 
 		/* check namespace of this tag */
 		if (cur->ns) {
-			if (ns_handler_item (parser->priv->handler, item, cur)) {
+			if (ns_handler_item (parser->priv->handler, &context->ns_cache, item, cur, context->fields)) {
 				cur = cur->next;
 				continue;
 			}
 		}
 
+		if (context->fields != GRSS_FEED_PARSER_FIELDS_ALL &&
+		    feed_parse_context_skip_field (context, rss_item_element_field (cur->name))) {
+			cur = cur->next;
+			continue;
+		}
+
 		if (!xmlStrcmp (cur->name, BAD_CAST"category")) {
  			tmp = (gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, 1);
 			if (tmp) {
@@ -302,10 +368,8 @@ parse_rss_item (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xm
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"comments")) {
  			tmp = (gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, 1);
-			if (tmp) {
-				grss_feed_item_set_comments_url (item, tmp);
-				g_free (tmp);
-			}
+			if (tmp)
+				grss_feed_item_set_comments_url_take (item, tmp);
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"pubDate")) {
  			tmp = (gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, 1);
@@ -370,26 +434,18 @@ parse_rss_item (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, xm
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"title")) {
  			tmp = unhtmlize ((gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, TRUE));
-			if (tmp) {
-				grss_feed_item_set_title (item, tmp);
-				g_free (tmp);
-			}
+			if (tmp)
+				grss_feed_item_set_title_take (item, tmp);
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"link")) {
  			tmp = unhtmlize ((gchar*) xmlNodeListGetString (doc, cur->xmlChildrenNode, TRUE));
-			if (tmp) {
-				grss_feed_item_set_source (item, tmp);
-				g_free (tmp);
-			}
+			if (tmp)
+				grss_feed_item_set_source_take (item, tmp);
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"description")) {
- 			tmp = xhtml_extract (cur, 0, NULL);
-			if (tmp) {
-				/* don't overwrite content:encoded descriptions... */
-				if (!grss_feed_item_get_description (item))
-					grss_feed_item_set_description (item, tmp);
-				g_free (tmp);
-			}
+			/* don't overwrite content:encoded descriptions... */
+			if (!grss_feed_item_has_description (item))
+				grss_feed_item_set_description_from_node (item, cur, NULL);
 		}
 		else if (!xmlStrcmp (cur->name, BAD_CAST"source")) {
 			tmp = (gchar*) xmlGetProp (cur, BAD_CAST"url");
@@ -432,21 +488,18 @@ parse_image (xmlNodePtr cur) {
 	return NULL;
 }
 
-static GList*
-feed_rss_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, GError **error)
+/*
+ * Parses the channel, and saves in @contents the first node holding items
+ * (or images and textinputs for RDF). Returns FALSE if the document is not
+ * valid
+ */
+static gboolean
+parse_header (FeedRssHandler *parser, GrssFeedChannel *feed, xmlDocPtr doc, FeedParseContext *context, xmlNodePtr *contents, GError **error)
 {
-	gchar *tmp;
 	gboolean rdf;
-	time_t now;
-	GList *items;
 	xmlNodePtr cur;
-	GrssFeedItem *item;
-	FeedRssHandler *parser;
 
-	items = NULL;
 	rdf = FALSE;
-	now = time (NULL);
-	parser = FEED_RSS_HANDLER (self);
 
 	cur = xmlDocGetRootElement (doc);
 	while (cur && xmlIsBlankNode (cur))
@@ -467,7 +520,7 @@ feed_rss_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc,
 	}
 	else {
 		g_set_error (error, FEED_RSS_HANDLER_ERROR, FEED_RSS_HANDLER_PARSE_ERROR, "Could not find RDF/RSS header!");
-		return NULL;
+		return FALSE;
 	}
 
 	while (cur && xmlIsBlankNode (cur))
@@ -482,7 +535,7 @@ feed_rss_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc,
 
 		if ((!xmlStrcmp (cur->name, BAD_CAST"channel")) ||
 		    (!xmlStrcmp (cur->name, BAD_CAST"Channel"))) {
-			parse_channel (parser, feed, doc, cur);
+			parse_channel (parser, feed, doc, cur, context);
 			if (rdf == FALSE)
 				cur = cur->xmlChildrenNode;
 			break;
@@ -491,6 +544,32 @@ feed_rss_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc,
 		cur = cur->next;
 	}
 
+	*contents = cur;
+	return TRUE;
+}
+
+static GList*
+feed_rss_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc, gboolean do_items, FeedParseContext *context, GError **error)
+{
+	gchar *tmp;
+	time_t now;
+	GList *items;
+	xmlNodePtr cur;
+	GrssFeedItem *item;
+	FeedRssHandler *parser;
+
+	items = NULL;
+	now = time (NULL);
+	parser = FEED_RSS_HANDLER (self);
+
+	if (context->resume != NULL) {
+		/* a parsing split in slices continues from where it stopped */
+		cur = feed_parse_context_resume (context);
+	}
+	else if (parse_header (parser, feed, doc, context, &cur, error) == FALSE) {
+		return NULL;
+	}
+
 	/* For RDF (rss 0.9 or 1.0), cur now points to the item after the channel tag. */
 	/* For RSS, cur now points to the first item inside of the channel tag */
 	/* This ends up being the thing with the items, (and images/textinputs for RDF) */
@@ -502,6 +581,9 @@ feed_rss_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc,
 			continue;
 		}
 
+		if (do_items == TRUE && feed_parse_context_yield (context, cur))
+			break;
+
 		/* save link to channel image */
 		if ((!xmlStrcmp (cur->name, BAD_CAST"image"))) {
 			if (NULL != (tmp = parse_image (cur))) {
@@ -513,25 +595,19 @@ feed_rss_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc,
 			xmlNodePtr iter = cur->xmlChildrenNode;
 
 			while (iter) {
-				item = parse_rss_item (parser, feed, doc, iter);
+				item = parse_rss_item (parser, feed, doc, iter, context);
 
-				if (item != NULL) {
-					if (grss_feed_item_get_publish_time (item) == 0)
-						grss_feed_item_set_publish_time (item, now);
+				if (item != NULL && feed_parse_context_collect_item (context, feed, item, now))
 					items = g_list_append (items, item);
-				}
 
 				iter = iter->next;
 			}
 		}
 		else if (do_items == TRUE && (!xmlStrcmp (cur->name, BAD_CAST"item"))) { /* RSS 1.0, 2.0 */
-			item = parse_rss_item (parser, feed, doc, cur);
+			item = parse_rss_item (parser, feed, doc, cur, context);
 
-			if (item != NULL) {
-				if (grss_feed_item_get_publish_time (item) == 0)
-					grss_feed_item_set_publish_time (item, now);
+			if (item != NULL && feed_parse_context_collect_item (context, feed, item, now))
 				items = g_list_append (items, item);
-			}
 		}
 
 		cur = cur->next;
@@ -539,6 +615,8 @@ feed_rss_handler_parse (FeedHandler *self, GrssFeedChannel *feed, xmlDocPtr doc,
 
 	grss_feed_channel_set_format (feed, "application/rss+xml");
 
+	context->reversed = TRUE;
+
 	if (items != NULL)
 		items = g_list_reverse (items);
 	return items;
@@ -548,7 +626,7 @@ static void
 feed_handler_interface_init (FeedHandlerInterface *iface)
 {
 	iface->set_ns_handler = feed_rss_handler_set_ns_handler;
-	iface->check_format = feed_rss_handler_check_format;
+	iface->get_roots = feed_rss_handler_get_roots;
 	iface->parse = feed_rss_handler_parse;
 }
 
@@ -170,7 +170,8 @@ grss_feeds_group_get_formats (GrssFeedsGroup *group)
  * @path: path of the file to parse.
  * @error: location for eventual errors.
  *
- * Parses the given file to obtain list of listed feeds.
+ * Parses the given file to obtain list of listed feeds. If the file cannot
+ * be read, @error holds the #GFileError of the failure.
  *
  * Returns: (element-type GrssFeedChannel) (transfer full): a list
  * of #GrssFeedChannels, or NULL if an error occours and @error is
@@ -180,6 +181,7 @@ GList*
 grss_feeds_group_parse_file (GrssFeedsGroup *group, const gchar *path, GError **error)
 {
 	GList *items;
+	GError *err;
 	xmlDocPtr doc;
 	xmlNodePtr cur;
 	GrssFeedsGroupHandler *handler;
@@ -188,9 +190,14 @@ grss_feeds_group_parse_file (GrssFeedsGroup *group, const gchar *path, GError **
 	doc = NULL;
 
 	do {
-		doc = file_to_xml (path);
+		err = NULL;
+		doc = file_to_xml_full (path, XML_DEFAULT_OPTIONS, NULL, &err);
 		if (doc == NULL) {
-			g_set_error (error, FEEDS_GROUP_ERROR, FEEDS_GROUP_PARSE_ERROR, "Empty document");
+			/* the file could not be read, or it is empty */
+			if (err != NULL)
+				g_propagate_error (error, err);
+			else
+				g_set_error (error, FEEDS_GROUP_ERROR, FEEDS_GROUP_PARSE_ERROR, "Empty document");
 			break;
 		}
 
@@ -228,6 +235,74 @@ grss_feeds_group_parse_file (GrssFeedsGroup *group, const gchar *path, GError **
 	return items;
 }
 
+static void
+free_channels_list (gpointer list)
+{
+	g_list_free_full (list, g_object_unref);
+}
+
+static void
+parse_file_thread (GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+	GList *items;
+	GError *error;
+
+	error = NULL;
+	items = grss_feeds_group_parse_file (source_object, task_data, &error);
+
+	if (error == NULL)
+		g_task_return_pointer (task, items, free_channels_list);
+	else
+		g_task_return_error (task, error);
+}
+
+/**
+ * grss_feeds_group_parse_file_async:
+ * @group: a #GrssFeedsGroup.
+ * @path: path of the file to parse.
+ * @cancellable: (allow-none): optional #GCancellable object, or %NULL.
+ * @callback: function to invoke at the end of the parsing.
+ * @user_data: (closure): data passed to the callback.
+ *
+ * Similar to grss_feeds_group_parse_file(), but the file is parsed in
+ * another thread, without blocking the main loop of the caller. The result
+ * has to be obtained with grss_feeds_group_parse_file_finish() in
+ * @callback.
+ */
+void
+grss_feeds_group_parse_file_async (GrssFeedsGroup *group, const gchar *path, GCancellable *cancellable,
+                                   GAsyncReadyCallback callback, gpointer user_data)
+{
+	GTask *task;
+
+	/* handlers are created here, not to race in the thread */
+	feeds_groups_get_list (group);
+
+	task = g_task_new (group, cancellable, callback, user_data);
+	g_task_set_task_data (task, g_strdup (path), g_free);
+	g_task_run_in_thread (task, parse_file_thread);
+	g_object_unref (task);
+}
+
+/**
+ * grss_feeds_group_parse_file_finish:
+ * @group: a #GrssFeedsGroup.
+ * @res: the #GAsyncResult passed to the callback.
+ * @error: location for eventual errors.
+ *
+ * Finalizes an operation started with grss_feeds_group_parse_file_async().
+ *
+ * Returns: (element-type GrssFeedChannel) (transfer full): a list
+ * of #GrssFeedChannels, or NULL if an error occours and @error is
+ * set.
+ */
+GList*
+grss_feeds_group_parse_file_finish (GrssFeedsGroup *group, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (res, group), NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
 /**
  * grss_feeds_group_export_file:
  * @group: a #GrssFeedsGroup.
@@ -48,6 +48,8 @@ GrssFeedsGroup*	grss_feeds_group_new		();
 
 GList*		grss_feeds_group_get_formats	(GrssFeedsGroup *group);
 GList*		grss_feeds_group_parse_file	(GrssFeedsGroup *group, const gchar *path, GError **error);
+void		grss_feeds_group_parse_file_async	(GrssFeedsGroup *group, const gchar *path, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+GList*		grss_feeds_group_parse_file_finish	(GrssFeedsGroup *group, GAsyncResult *res, GError **error);
 gboolean	grss_feeds_group_export_file	(GrssFeedsGroup *group, GList *channels, const gchar *format, const gchar *uri, GError **error);
 
 #endif /* __FEEDS_GROUP_H__ */
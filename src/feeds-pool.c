@@ -21,6 +21,7 @@
 #include "feeds-pool.h"
 #include "utils.h"
 #include "feed-parser.h"
+#include "feed-channel-private.h"
 #include "feed-marshal.h"
 
 #define FEEDS_POOL_GET_PRIVATE(obj)     (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GRSS_FEEDS_POOL_TYPE, GrssFeedsPoolPrivate))
@@ -328,7 +329,7 @@ fetch_feeds (gpointer data)
 		feed = (GrssFeedChannelWrap*) iter->data;
 		if (feed->next_fetch <= now) {
 			g_signal_emit (feed->pool, signals[FEED_FETCHING], 0, feed->channel);
-			grss_feed_channel_fetch_all_async (feed->channel, feed_downloaded, feed);
+			grss_feed_channel_fetch_all_with_parser_async (feed->channel, feed->pool->priv->parser, feed_downloaded, feed);
 		}
 	}
 
@@ -405,3 +406,19 @@ grss_feeds_pool_get_session (GrssFeedsPool *pool)
 {
 	return pool->priv->soupsession;
 }
+
+/**
+ * grss_feeds_pool_get_parser:
+ * @pool: a #GrssFeedsPool.
+ *
+ * To access the internal #GrssFeedParser used by the @pool to parse items,
+ * e.g. to set a function to skip already known items with
+ * grss_feed_parser_set_seen_func().
+ *
+ * Returns: (transfer none): instance of #GrssFeedParser. Do not free it.
+ */
+GrssFeedParser*
+grss_feeds_pool_get_parser (GrssFeedsPool *pool)
+{
+	return pool->priv->parser;
+}
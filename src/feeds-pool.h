@@ -54,5 +54,6 @@ GList*		grss_feeds_pool_get_listened		(GrssFeedsPool *pool);
 int		grss_feeds_pool_get_listened_num	(GrssFeedsPool *pool);
 void		grss_feeds_pool_switch			(GrssFeedsPool *pool, gboolean run);
 SoupSession*	grss_feeds_pool_get_session		(GrssFeedsPool *pool);
+GrssFeedParser*	grss_feeds_pool_get_parser		(GrssFeedsPool *pool);
 
 #endif /* __FEEDS_POOL_H__ */
@@ -20,6 +20,7 @@
 
 #include "feeds-pubsubhubbub-subscriber.h"
 #include "feeds-subscriber.h"
+#include "feeds-subscriber-private.h"
 #include "feeds-subscriber-handler.h"
 #include "utils.h"
 #include "feed-parser.h"
@@ -28,7 +29,6 @@
 
 struct _GrssFeedsPubsubhubbubSubscriberPrivate {
 	GrssFeedsSubscriber	*parent;
-	GrssFeedParser		*parser;
 };
 
 static void feeds_subscriber_handler_interface_init (GrssFeedsSubscriberHandlerInterface *iface);
@@ -36,24 +36,10 @@ G_DEFINE_TYPE_WITH_CODE (GrssFeedsPubsubhubbubSubscriber, grss_feeds_pubsubhubbu
                          G_IMPLEMENT_INTERFACE (GRSS_FEEDS_SUBSCRIBER_HANDLER_TYPE,
                                                 feeds_subscriber_handler_interface_init));
 
-static void
-grss_feeds_pubsubhubbub_subscriber_finalize (GObject *obj)
-{
-	GrssFeedsPubsubhubbubSubscriber *sub;
-
-	sub = GRSS_FEEDS_PUBSUBHUBBUB_SUBSCRIBER (obj);
-	g_object_unref (sub->priv->parser);
-}
-
 static void
 grss_feeds_pubsubhubbub_subscriber_class_init (GrssFeedsPubsubhubbubSubscriberClass *klass)
 {
-	GObjectClass *gobject_class;
-
 	g_type_class_add_private (klass, sizeof (GrssFeedsPubsubhubbubSubscriberPrivate));
-
-	gobject_class = G_OBJECT_CLASS (klass);
-	gobject_class->finalize = grss_feeds_pubsubhubbub_subscriber_finalize;
 }
 
 static void
@@ -61,7 +47,6 @@ grss_feeds_pubsubhubbub_subscriber_init (GrssFeedsPubsubhubbubSubscriber *node)
 {
 	node->priv = FEEDS_SUBSCRIBER_GET_PRIVATE (node);
 	memset (node->priv, 0, sizeof (GrssFeedsPubsubhubbubSubscriberPrivate));
-	node->priv->parser = grss_feed_parser_new ();
 }
 
 GrssFeedsPubsubhubbubSubscriber*
@@ -177,9 +162,10 @@ feeds_pubsubhubbub_subscriber_handler_handle_message (GrssFeedsSubscriberHandler
 		myself = GRSS_FEEDS_PUBSUBHUBBUB_SUBSCRIBER (handler);
 		doc = content_to_xml (msg->request_body->data, strlen (msg->request_body->data));
 		error = NULL;
-		items = grss_feed_parser_parse (myself->priv->parser, channel, doc, &error);
+		/* the parser of the subscriber skips items already notified */
+		items = grss_feed_parser_parse (grss_feeds_subscriber_get_parser (myself->priv->parent), channel, doc, &error);
 
-		if (items == NULL) {
+		if (error != NULL) {
 			g_warning ("Unable to parse notification from %s: %s", grss_feed_channel_get_source (channel), error->message);
 			g_error_free (error);
 		}
@@ -24,6 +24,7 @@
 #include "feeds-subscriber-handler.h"
 #include "utils.h"
 #include "feed-parser.h"
+#include "feed-channel-private.h"
 
 #define FEEDS_SUBSCRIBER_GET_PRIVATE(obj)	(G_TYPE_INSTANCE_GET_PRIVATE ((obj), GRSS_FEEDS_RSSCLOUD_SUBSCRIBER_TYPE, GrssFeedsRsscloudSubscriberPrivate))
 
@@ -162,8 +163,8 @@ fetched_items_cb (GObject *source_object,
 	GrssFeedChannel *channel;
 	GrssFeedsRsscloudSubscriber *handler;
 
-	items = g_async_result_get_user_data (res);
-	channel = GRSS_FEED_CHANNEL (g_async_result_get_source_object (res));
+	channel = GRSS_FEED_CHANNEL (source_object);
+	items = grss_feed_channel_fetch_all_finish (channel, res, NULL);
 	handler = user_data;
 
 	grss_feeds_subscriber_dispatch (handler->priv->parent, channel, items);
@@ -181,8 +182,10 @@ feeds_rsscloud_subscriber_handler_handle_message (GrssFeedsSubscriberHandler *ha
 {
 	GList *ret;
 	gchar *challenge;
+	GrssFeedsRsscloudSubscriber *myself;
 
 	ret = NULL;
+	myself = GRSS_FEEDS_RSSCLOUD_SUBSCRIBER (handler);
 
 	if (query != NULL) {
 		challenge = (gchar*) g_hash_table_lookup (query, "challenge");
@@ -195,7 +198,8 @@ feeds_rsscloud_subscriber_handler_handle_message (GrssFeedsSubscriberHandler *ha
 		}
 	}
 	else if (*status == FEED_SUBSCRIPTION_SUBSCRIBED) {
-		grss_feed_channel_fetch_all_async (channel, fetched_items_cb, handler);
+		grss_feed_channel_fetch_all_with_parser_async (channel, grss_feeds_subscriber_get_parser (myself->priv->parent),
+		                                               fetched_items_cb, handler);
 		soup_message_set_status (msg, 202);
 	}
 	else {
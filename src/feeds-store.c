@@ -132,6 +132,12 @@ feed_fetched (GrssFeedsPool *pool, GrssFeedChannel *feed, GList *items, gpointer
 	}
 }
 
+static gboolean
+item_is_known (GrssFeedChannel *channel, const gchar *id, gpointer user_data)
+{
+	return grss_feeds_store_has_item ((GrssFeedsStore*) user_data, channel, id);
+}
+
 /**
  * grss_feeds_store_switch:
  * @store: a #GrssFeedsStore.
@@ -153,6 +159,9 @@ grss_feeds_store_switch (GrssFeedsStore *store, gboolean run)
 		if (store->priv->pool == NULL) {
 			store->priv->pool = grss_feeds_pool_new ();
 			g_signal_connect (store->priv->pool, "feed-ready", G_CALLBACK (feed_fetched), store);
+
+			/* items already saved are not even parsed */
+			grss_feed_parser_set_seen_func (grss_feeds_pool_get_parser (store->priv->pool), item_is_known, store, NULL);
 		}
 
 		channels = grss_feeds_store_get_channels (store);
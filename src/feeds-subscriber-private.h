@@ -21,6 +21,7 @@
 #ifndef __FEEDS_SUBSCRIBER_PRIVATE_H__
 #define __FEEDS_SUBSCRIBER_PRIVATE_H__
 
-void		grss_feeds_subscriber_dispatch	(GrssFeedsSubscriber *sub, GrssFeedChannel *channel, GList *items);
+void		grss_feeds_subscriber_dispatch		(GrssFeedsSubscriber *sub, GrssFeedChannel *channel, GList *items);
+GrssFeedParser*	grss_feeds_subscriber_get_parser	(GrssFeedsSubscriber *sub);
 
 #endif
@@ -93,6 +93,45 @@ static guint signals [LAST_SIGNAL] = {0};
 
 G_DEFINE_TYPE (GrssFeedsSubscriber, grss_feeds_subscriber, G_TYPE_OBJECT);
 
+static gboolean
+wrap_has_item (GrssFeedChannelWrap *feed, const gchar *id)
+{
+	GList *cache_iter;
+	GrssFeedItem *cache_item;
+
+	for (cache_iter = feed->items_cache; cache_iter; cache_iter = g_list_next (cache_iter)) {
+		cache_item = (GrssFeedItem*) cache_iter->data;
+		if (strcmp (id, grss_feed_item_get_id (cache_item)) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static GrssFeedChannelWrap*
+find_wrap (GrssFeedsSubscriber *sub, GrssFeedChannel *channel)
+{
+	GList *iter;
+	GrssFeedChannelWrap *wrap;
+
+	for (iter = sub->priv->feeds_list; iter; iter = g_list_next (iter)) {
+		wrap = (GrssFeedChannelWrap*) iter->data;
+		if (wrap->channel == channel)
+			return wrap;
+	}
+
+	return NULL;
+}
+
+static gboolean
+item_is_cached (GrssFeedChannel *channel, const gchar *id, gpointer user_data)
+{
+	GrssFeedChannelWrap *wrap;
+
+	wrap = find_wrap ((GrssFeedsSubscriber*) user_data, channel);
+	return (wrap != NULL && wrap_has_item (wrap, id));
+}
+
 static void
 remove_currently_listened (GrssFeedsSubscriber *sub)
 {
@@ -171,6 +210,7 @@ grss_feeds_subscriber_init (GrssFeedsSubscriber *node)
 	node->priv = FEEDS_SUBSCRIBER_GET_PRIVATE (node);
 	memset (node->priv, 0, sizeof (GrssFeedsSubscriberPrivate));
 	node->priv->parser = grss_feed_parser_new ();
+	grss_feed_parser_set_seen_func (node->priv->parser, item_is_cached, node, NULL);
 	node->priv->port = DEFAULT_SERVER_PORT;
 
 	node->priv->handlers = NULL;
@@ -296,26 +336,13 @@ grss_feeds_subscriber_get_listened (GrssFeedsSubscriber *sub)
 static void
 dispatch_items (GrssFeedChannelWrap *feed, GList *items)
 {
-	gboolean exists;
-	const gchar* item_id;
 	GList *iter;
-	GList *cache_iter;
 	GrssFeedItem *item;
-	GrssFeedItem *cache_item;
 
 	for (iter = items; iter; iter = g_list_next (iter)) {
 		item = (GrssFeedItem*) iter->data;
-		item_id = grss_feed_item_get_id (item);
-
-		exists = FALSE;
-
-		for (cache_iter = feed->items_cache; cache_iter; cache_iter = g_list_next (cache_iter)) {
-			cache_item = (GrssFeedItem*) cache_iter->data;
-			if (strcmp (item_id, grss_feed_item_get_id (cache_item)) == 0)
-				exists = TRUE;
-		}
 
-		if (exists == FALSE) {
+		if (wrap_has_item (feed, grss_feed_item_get_id (item)) == FALSE) {
 			g_signal_emit (feed->sub, signals [NOTIFICATION_RECEIVED], 0, feed->channel, item, NULL);
 			feed->items_cache = g_list_prepend (feed->items_cache, item);
 		}
@@ -341,17 +368,20 @@ handle_incoming_notification_cb (SoupServer *server, SoupMessage *msg, const cha
 void
 grss_feeds_subscriber_dispatch (GrssFeedsSubscriber *sub, GrssFeedChannel *channel, GList *items)
 {
-	GList *iter;
 	GrssFeedChannelWrap *wrap;
 
-	for (iter = sub->priv->feeds_list; iter; iter = g_list_next (iter)) {
-		wrap = (GrssFeedChannelWrap*) iter->data;
+	wrap = find_wrap (sub, channel);
+	if (wrap != NULL)
+		dispatch_items (wrap, items);
+}
 
-		if (wrap->channel == channel) {
-			dispatch_items (wrap, items);
-			break;
-		}
-	}
+/*
+ * The parser to be used by handlers: items already notified are skipped
+ */
+GrssFeedParser*
+grss_feeds_subscriber_get_parser (GrssFeedsSubscriber *sub)
+{
+	return sub->priv->parser;
 }
 
 static void
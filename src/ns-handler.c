@@ -21,21 +21,46 @@
 
 #include "utils.h"
 #include "ns-handler.h"
+#include "feed-item-private.h"
 
 #define NS_HANDLER_GET_PRIVATE(obj)     (G_TYPE_INSTANCE_GET_PRIVATE ((obj), NS_HANDLER_TYPE, NSHandlerPrivate))
 
 struct _NSHandlerPrivate {
 	GHashTable	*href_handlers;
 	GHashTable	*prefix_handlers;
+	GSList		*all_handlers;
 };
 
 typedef struct {
-	gboolean	(*handle_channel)	(GrssFeedChannel *channel, xmlNodePtr cur);
-	void		(*handle_item)		(GrssFeedItem *item, xmlNodePtr cur);
+	GrssFeedParserFields	module;
+	gboolean		(*handle_channel)	(GrssFeedChannel *channel, xmlNodePtr cur);
+	void			(*handle_item)		(GrssFeedItem *item, xmlNodePtr cur);
+
+	/* only for handlers registered with ns_handler_register() */
+	GrssFeedParserChannelNsFunc	channel_func;
+	GrssFeedParserItemNsFunc	item_func;
+	gpointer		user_data;
+	GDestroyNotify		destroy;
+	gchar			*prefix;
+	gchar			*href;
 } InternalNsHandler;
 
+#define HAS_CHANNEL_HANDLER(nsh)	((nsh)->handle_channel != NULL || (nsh)->channel_func != NULL)
+#define HAS_ITEM_HANDLER(nsh)		((nsh)->handle_item != NULL || (nsh)->item_func != NULL)
+
 G_DEFINE_TYPE (NSHandler, ns_handler, G_TYPE_OBJECT);
 
+static void
+free_internal_handler (InternalNsHandler *nsh)
+{
+	if (nsh->destroy != NULL)
+		nsh->destroy (nsh->user_data);
+
+	g_free (nsh->prefix);
+	g_free (nsh->href);
+	g_free (nsh);
+}
+
 static void
 ns_handler_finalize (GObject *obj)
 {
@@ -44,6 +69,9 @@ ns_handler_finalize (GObject *obj)
 	hand = NS_HANDLER (obj);
 	g_hash_table_destroy (hand->priv->href_handlers);
 	g_hash_table_destroy (hand->priv->prefix_handlers);
+	g_slist_free_full (hand->priv->all_handlers, (GDestroyNotify) free_internal_handler);
+
+	G_OBJECT_CLASS (ns_handler_parent_class)->finalize (obj);
 }
 
 static void
@@ -82,15 +110,8 @@ ns_admin_channel (GrssFeedChannel *feed, xmlNodePtr cur)
 static void
 ns_content_item (GrssFeedItem *item, xmlNodePtr cur)
 {
-	gchar *tmp;
-
-  	if (!xmlStrcmp (cur->name, BAD_CAST "encoded")) {
-		tmp = xhtml_extract (cur, 0, NULL);
-		if (tmp) {
-			grss_feed_item_set_description (item, tmp);
-			g_free (tmp);
-		}
-	}
+  	if (!xmlStrcmp (cur->name, BAD_CAST "encoded"))
+		grss_feed_item_set_description_from_node (item, cur, NULL);
 }
 
 static void
@@ -454,10 +475,8 @@ ns_wfw_item (GrssFeedItem *item, xmlNodePtr cur)
  	if (!xmlStrcmp (BAD_CAST"commentRss", cur->name) || !xmlStrcmp (BAD_CAST"commentRSS", cur->name))
 		uri = (gchar*) xmlNodeListGetString (cur->doc, cur->xmlChildrenNode, 1);
 
-	if (uri) {
-		grss_feed_item_set_comments_url (item, uri);
-		g_free (uri);
-	}
+	if (uri)
+		grss_feed_item_set_comments_url_take (item, uri);
 }
 
 static gboolean
@@ -486,6 +505,22 @@ ns_atom10_channel (GrssFeedChannel *feed, xmlNodePtr cur)
 	return FALSE;
 }
 
+/*
+ * Handlers are shared by many keys in the tables, so they are owned by a
+ * separate list. @module is the flag enabling the handler in the fields of
+ * the parser, or 0 if it is always used
+ */
+static InternalNsHandler*
+new_internal_handler (NSHandler *node, GrssFeedParserFields module)
+{
+	InternalNsHandler *nsh;
+
+	nsh = g_new0 (InternalNsHandler, 1);
+	nsh->module = module;
+	node->priv->all_handlers = g_slist_prepend (node->priv->all_handlers, nsh);
+	return nsh;
+}
+
 /*
 	TODO	Look at
 		http://www.dmoz.org/Computers/Internet/On_the_Web/Syndication_and_Feeds/RSS/Specifications/RSS_1.0_Modules/
@@ -501,10 +536,10 @@ ns_handler_init (NSHandler *node)
 	node->priv = NS_HANDLER_GET_PRIVATE (node);
 	memset (node->priv, 0, sizeof (NSHandlerPrivate));
 
-	node->priv->href_handlers = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
-	node->priv->prefix_handlers = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+	node->priv->href_handlers = g_hash_table_new (g_str_hash, g_str_equal);
+	node->priv->prefix_handlers = g_hash_table_new (g_str_hash, g_str_equal);
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_OTHER);
 	nsh->handle_channel = ns_admin_channel;
 	nsh->handle_item = NULL;
 	g_hash_table_insert (node->priv->prefix_handlers, "admin", nsh);
@@ -512,19 +547,19 @@ ns_handler_init (NSHandler *node)
 
 	/*
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_OTHER);
 	nsh->handle_channel = NULL;
 	nsh->handle_item = ns_aggregation_item;
 	g_hash_table_insert (node->priv->prefix_handlers, "ag", nsh);
 	g_hash_table_insert (node->priv->href_handlers, "http://purl.org/rss/1.0/modules/aggregation/", nsh);
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_OTHER);
 	nsh->handle_channel = ns_blog_channel;
 	nsh->handle_item = NULL;
 	g_hash_table_insert (node->priv->prefix_handlers, "blogChannel", nsh);
 	g_hash_table_insert (node->priv->href_handlers, "http://backend.userland.com/blogChannelModule", nsh);
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_OTHER);
 	nsh->handle_channel = ns_creativecommons_channel;
 	nsh->handle_item = ns_creativecommons_item;
 	g_hash_table_insert (node->priv->prefix_handlers, "cc", nsh);
@@ -534,38 +569,38 @@ ns_handler_init (NSHandler *node)
 
 	*/
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_CONTENT);
 	nsh->handle_channel = NULL;
 	nsh->handle_item = ns_content_item;
 	g_hash_table_insert (node->priv->prefix_handlers, "content", nsh);
 	g_hash_table_insert (node->priv->href_handlers, "http://purl.org/rss/1.0/modules/content/", nsh);
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_DC);
 	nsh->handle_channel = ns_dc_channel;
 	nsh->handle_item = ns_dc_item;
 	g_hash_table_insert (node->priv->prefix_handlers, "dc", nsh);
 	g_hash_table_insert (node->priv->href_handlers, "http://purl.org/dc/elements/1.1/", nsh);
 	g_hash_table_insert (node->priv->href_handlers, "http://purl.org/dc/elements/1.0/", nsh);
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_GEO);
 	nsh->handle_channel = NULL;
 	nsh->handle_item = ns_georss_item;
 	g_hash_table_insert (node->priv->prefix_handlers, "georss", nsh);
 	g_hash_table_insert (node->priv->href_handlers, "http://www.georss.org/georss", nsh);
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_GEO);
 	nsh->handle_channel = NULL;
 	nsh->handle_item = ns_geo_item;
 	g_hash_table_insert (node->priv->prefix_handlers, "geo", nsh);
 	g_hash_table_insert (node->priv->href_handlers, "http://www.w3.org/2003/01/geo/wgs84_pos#", nsh);
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_ITUNES);
 	nsh->handle_channel = ns_itunes_channel;
 	nsh->handle_item = ns_itunes_item;
 	g_hash_table_insert (node->priv->prefix_handlers, "itunes", nsh);
 	g_hash_table_insert (node->priv->href_handlers, "http://www.itunes.com/dtds/podcast-1.0.dtd", nsh);
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_MEDIA);
 	nsh->handle_channel = NULL;
 	nsh->handle_item = ns_media_item;
 	g_hash_table_insert (node->priv->prefix_handlers, "media", nsh);
@@ -573,13 +608,13 @@ ns_handler_init (NSHandler *node)
 
 	/*
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_MEDIA);
 	nsh->handle_channel = NULL;
 	nsh->handle_item = ns_photo_item;
 	g_hash_table_insert (node->priv->prefix_handlers, "photo", nsh);
 	g_hash_table_insert (node->priv->href_handlers, "http://www.pheed.com/pheed/", nsh);
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_OTHER);
 	nsh->handle_channel = NULL;
 	nsh->handle_item = ns_slash_item;
 	g_hash_table_insert (node->priv->prefix_handlers, "slash", nsh);
@@ -587,25 +622,25 @@ ns_handler_init (NSHandler *node)
 
 	*/
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, 0);
 	nsh->handle_channel = ns_syn_channel;
 	nsh->handle_item = NULL;
 	g_hash_table_insert (node->priv->prefix_handlers, "syn", nsh);
 	g_hash_table_insert (node->priv->href_handlers, "http://purl.org/rss/1.0/modules/syndication/", nsh);
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_OTHER);
 	nsh->handle_channel = NULL;
 	nsh->handle_item = ns_trackback_item;
 	g_hash_table_insert (node->priv->prefix_handlers, "trackback", nsh);
 	g_hash_table_insert (node->priv->href_handlers, "http://madskills.com/public/xml/rss/module/trackback/", nsh);
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, GRSS_FEED_PARSER_MODULE_OTHER);
 	nsh->handle_channel = NULL;
 	nsh->handle_item = ns_wfw_item;
 	g_hash_table_insert (node->priv->prefix_handlers, "wfw", nsh);
 	g_hash_table_insert (node->priv->href_handlers, "http://wellformedweb.org/CommentAPI", nsh);
 
-	nsh = g_new0 (InternalNsHandler, 1);
+	nsh = new_internal_handler (node, 0);
 	nsh->handle_channel = ns_atom10_channel;
 	nsh->handle_item = NULL;
 	g_hash_table_insert (node->priv->prefix_handlers, "atom10", nsh);
@@ -618,6 +653,35 @@ ns_handler_new ()
 	return g_object_new (NS_HANDLER_TYPE, NULL);
 }
 
+/*
+ * Adds an handler for the namespace identified by @href or @prefix (or
+ * both), replacing the one eventually already existing. Not thread safe:
+ * to be called before using the handler for parsing
+ */
+void
+ns_handler_register (NSHandler *handler, const gchar *prefix, const gchar *href,
+                     GrssFeedParserChannelNsFunc channel_func, GrssFeedParserItemNsFunc item_func,
+                     gpointer user_data, GDestroyNotify destroy)
+{
+	InternalNsHandler *nsh;
+
+	nsh = new_internal_handler (handler, GRSS_FEED_PARSER_MODULE_OTHER);
+	nsh->channel_func = channel_func;
+	nsh->item_func = item_func;
+	nsh->user_data = user_data;
+	nsh->destroy = destroy;
+
+	if (prefix != NULL) {
+		nsh->prefix = g_strdup (prefix);
+		g_hash_table_insert (handler->priv->prefix_handlers, nsh->prefix, nsh);
+	}
+
+	if (href != NULL) {
+		nsh->href = g_strdup (href);
+		g_hash_table_insert (handler->priv->href_handlers, nsh->href, nsh);
+	}
+}
+
 static InternalNsHandler*
 retrieve_internal_handler (NSHandler *handler, xmlNodePtr cur)
 {
@@ -634,31 +698,90 @@ retrieve_internal_handler (NSHandler *handler, xmlNodePtr cur)
 	return nsh;
 }
 
-gboolean
-ns_handler_channel (NSHandler *handler, GrssFeedChannel *feed, xmlNodePtr cur)
+/*
+ * Same as retrieve_internal_handler(), but the result is saved in @cache
+ * (if not NULL) and reused for all the elements in the same namespace. Also
+ * the namespaces without a handler are saved
+ */
+static InternalNsHandler*
+lookup_internal_handler (NSHandler *handler, NSHandlerCache *cache, xmlNodePtr cur)
 {
+	guint i;
 	InternalNsHandler *nsh;
 
+	if (cache != NULL) {
+		for (i = 0; i < cache->len; i++)
+			if (cache->ns [i] == cur->ns)
+				return cache->handlers [i];
+	}
+
 	nsh = retrieve_internal_handler (handler, cur);
 
-	if (nsh != NULL && nsh->handle_channel != NULL)
-		return nsh->handle_channel (feed, cur);
-	else
+	if (cache != NULL && cache->len < NS_HANDLER_CACHE_SIZE) {
+		cache->ns [cache->len] = cur->ns;
+		cache->handlers [cache->len] = nsh;
+		cache->len++;
+	}
+
+	return nsh;
+}
+
+gboolean
+ns_handler_channel (NSHandler *handler, NSHandlerCache *cache, GrssFeedChannel *feed, xmlNodePtr cur)
+{
+	InternalNsHandler *nsh;
+
+	nsh = lookup_internal_handler (handler, cache, cur);
+
+	if (nsh != NULL && HAS_CHANNEL_HANDLER (nsh)) {
+		if (nsh->handle_channel != NULL)
+			return nsh->handle_channel (feed, cur);
+		else
+			return nsh->channel_func (feed, cur, nsh->user_data);
+	}
+	else {
 		return FALSE;
+	}
 }
 
 gboolean
-ns_handler_item (NSHandler *handler, GrssFeedItem *item, xmlNodePtr cur)
+ns_handler_item (NSHandler *handler, NSHandlerCache *cache, GrssFeedItem *item, xmlNodePtr cur, GrssFeedParserFields fields)
 {
 	InternalNsHandler *nsh;
 
-	nsh = retrieve_internal_handler (handler, cur);
+	nsh = lookup_internal_handler (handler, cache, cur);
 
-	if (nsh != NULL && nsh->handle_item != NULL) {
-		nsh->handle_item (item, cur);
+	if (nsh != NULL && HAS_ITEM_HANDLER (nsh)) {
+		/*
+		 * disabled modules just consume their elements, but dc:date
+		 * is the only date of RSS 1.0 items, which are always parsed
+		 */
+		if (nsh->module != 0 && (nsh->module & fields) == 0 &&
+		    (nsh->module != GRSS_FEED_PARSER_MODULE_DC || xmlStrcmp (cur->name, BAD_CAST "date") != 0))
+			return TRUE;
+		else if (nsh->handle_item != NULL)
+			nsh->handle_item (item, cur);
+		else
+			nsh->item_func (item, cur, nsh->user_data);
 		return TRUE;
 	}
 	else {
 		return FALSE;
 	}
 }
+
+/*
+ * TRUE if ns_handler_item() would consume the node, without touching any
+ * item
+ */
+gboolean
+ns_handler_handles_item (NSHandler *handler, NSHandlerCache *cache, xmlNodePtr cur)
+{
+	InternalNsHandler *nsh;
+
+	if (cur->ns == NULL)
+		return FALSE;
+
+	nsh = lookup_internal_handler (handler, cache, cur);
+	return (nsh != NULL && HAS_ITEM_HANDLER (nsh));
+}
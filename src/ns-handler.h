@@ -42,11 +42,28 @@ typedef struct {
 	GObjectClass parent;
 } NSHandlerClass;
 
+/*
+ * Handlers already resolved for the namespaces of a document, so that each
+ * xmlNs is looked up only once. Zero-filled at the beginning of the parsing
+ */
+#define NS_HANDLER_CACHE_SIZE		16
+
+typedef struct {
+	guint		len;
+	xmlNsPtr	ns [NS_HANDLER_CACHE_SIZE];
+	gpointer	handlers [NS_HANDLER_CACHE_SIZE];
+} NSHandlerCache;
+
 GType		ns_handler_get_type	() G_GNUC_CONST;
 
 NSHandler*	ns_handler_new		();
 
-gboolean	ns_handler_channel	(NSHandler *handler, GrssFeedChannel *feed, xmlNodePtr cur);
-gboolean	ns_handler_item		(NSHandler *handler, GrssFeedItem *item, xmlNodePtr cur);
+void		ns_handler_register	(NSHandler *handler, const gchar *prefix, const gchar *href,
+					 GrssFeedParserChannelNsFunc channel_func, GrssFeedParserItemNsFunc item_func,
+					 gpointer user_data, GDestroyNotify destroy);
+
+gboolean	ns_handler_channel	(NSHandler *handler, NSHandlerCache *cache, GrssFeedChannel *feed, xmlNodePtr cur);
+gboolean	ns_handler_item		(NSHandler *handler, NSHandlerCache *cache, GrssFeedItem *item, xmlNodePtr cur, GrssFeedParserFields fields);
+gboolean	ns_handler_handles_item	(NSHandler *handler, NSHandlerCache *cache, xmlNodePtr cur);
 
 #endif /* __NS_HANDLER_H__ */
@@ -16,6 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "utils.h"
 #include "person.h"
 
 /**
@@ -33,6 +34,11 @@
  * grss_person_unref(). When the reference count drops to 0, the
  * resources allocated by the #GrssPerson structure are released.
  *
+ * Being immutable, persons with the same name, email and uri are shared:
+ * grss_person_new() returns a new reference to an existing #GrssPerson
+ * when possible, so that the many items of a feed written by the same
+ * author all point to the same instance.
+ *
  * #GrssPerson is available since Grss 0.7.
  */
 
@@ -47,6 +53,32 @@ struct _GrssPerson
 
 G_DEFINE_BOXED_TYPE (GrssPerson, grss_person, grss_person_ref, grss_person_unref)
 
+/*
+ * Table of the existing persons, not holding references. As strings are
+ * interned, persons are compared by the pointers of their fields. A person
+ * is removed from the table when its reference count drops to 0, which
+ * happens only with the lock held
+ */
+static GHashTable *interned_persons = NULL;
+static GMutex interned_persons_lock;
+
+static guint
+person_hash (gconstpointer key)
+{
+  const GrssPerson *person = key;
+
+  return g_direct_hash (person->name) ^ (g_direct_hash (person->email) * 31) ^ (g_direct_hash (person->uri) * 961);
+}
+
+static gboolean
+person_equal (gconstpointer a, gconstpointer b)
+{
+  const GrssPerson *first = a;
+  const GrssPerson *second = b;
+
+  return (first->name == second->name && first->email == second->email && first->uri == second->uri);
+}
+
 static GrssPerson *
 grss_person_alloc (void)
 {
@@ -93,13 +125,32 @@ grss_person_ref (GrssPerson *person)
 void
 grss_person_unref (GrssPerson *person)
 {
+  gint old;
+
   g_return_if_fail (person != NULL);
   g_return_if_fail (person->ref_count > 0);
 
-  if (g_atomic_int_dec_and_test (&person->ref_count)) {
-    g_free (person->name);
-    g_free (person->email);
-    g_free (person->uri);
+  /* references but the last one are dropped without locking */
+  do {
+    old = g_atomic_int_get (&person->ref_count);
+    if (old > 1 && g_atomic_int_compare_and_exchange (&person->ref_count, old, old - 1))
+      return;
+  } while (old > 1);
+
+  g_mutex_lock (&interned_persons_lock);
+
+  /* another reference may have been taken by grss_person_new() meanwhile */
+  if (g_atomic_int_dec_and_test (&person->ref_count))
+    g_hash_table_remove (interned_persons, person);
+  else
+    person = NULL;
+
+  g_mutex_unlock (&interned_persons_lock);
+
+  if (person != NULL) {
+    release_string (person->name);
+    release_string (person->email);
+    release_string (person->uri);
     g_slice_free (GrssPerson, person);
   }
 }
@@ -110,9 +161,10 @@ grss_person_unref (GrssPerson *person)
  * @email: (allow-none): the email of the person, or %NULL
  * @uri: (allow-none): the homepage (uri) of the person, or %NULL
  *
- * Creates a new #GrssPerson.
+ * Creates a new #GrssPerson, or returns a new reference to an existing one
+ * with the same values.
  *
- * Returns: a new #GrssPerson, or %NULL
+ * Returns: a #GrssPerson, or %NULL
  *
  * Since: 0.7
  */
@@ -121,12 +173,41 @@ grss_person_new (const gchar *name,
                  const gchar *email,
                  const gchar *uri)
 {
+  gboolean found;
+  GrssPerson key;
   GrssPerson *person;
 
-  person = grss_person_alloc ();
-  person->name = g_strdup (name);
-  person->email = g_strdup (email);
-  person->uri = g_strdup (uri);
+  key.name = intern_string (name);
+  key.email = intern_string (email);
+  key.uri = intern_string (uri);
+
+  g_mutex_lock (&interned_persons_lock);
+
+  if (interned_persons == NULL)
+    interned_persons = g_hash_table_new (person_hash, person_equal);
+
+  person = g_hash_table_lookup (interned_persons, &key);
+  found = (person != NULL);
+
+  if (found) {
+    g_atomic_int_inc (&person->ref_count);
+  }
+  else {
+    person = grss_person_alloc ();
+    person->name = key.name;
+    person->email = key.email;
+    person->uri = key.uri;
+    g_hash_table_add (interned_persons, person);
+  }
+
+  g_mutex_unlock (&interned_persons_lock);
+
+  /* the existing person already holds its own references to the strings */
+  if (found) {
+    release_string (key.name);
+    release_string (key.email);
+    release_string (key.uri);
+  }
 
   return person;
 }
@@ -75,6 +75,261 @@ _unxmlize (gchar *string, ResultBuffer *buffer)
  	g_free(sax_p);
 }
 
+/* Most common HTML entities, sorted by name to be searched with bsearch().
+   Everything else is left to the HTML parser */
+typedef struct {
+	const gchar *name;
+	gunichar value;
+} HtmlEntity;
+
+static const HtmlEntity html_entities [] = {
+	{ "amp", '&' },
+	{ "apos", '\'' },
+	{ "bdquo", 0x201E },
+	{ "bull", 0x2022 },
+	{ "cent", 0x00A2 },
+	{ "copy", 0x00A9 },
+	{ "deg", 0x00B0 },
+	{ "eacute", 0x00E9 },
+	{ "egrave", 0x00E8 },
+	{ "euro", 0x20AC },
+	{ "gt", '>' },
+	{ "hellip", 0x2026 },
+	{ "laquo", 0x00AB },
+	{ "ldquo", 0x201C },
+	{ "lsquo", 0x2018 },
+	{ "lt", '<' },
+	{ "mdash", 0x2014 },
+	{ "middot", 0x00B7 },
+	{ "nbsp", 0x00A0 },
+	{ "ndash", 0x2013 },
+	{ "pound", 0x00A3 },
+	{ "quot", '"' },
+	{ "raquo", 0x00BB },
+	{ "rdquo", 0x201D },
+	{ "reg", 0x00AE },
+	{ "rsquo", 0x2019 },
+	{ "sbquo", 0x201A },
+	{ "times", 0x00D7 },
+	{ "trade", 0x2122 },
+	{ "yen", 0x00A5 }
+};
+
+#define HTML_ENTITY_NAME_MAX	6
+
+/* Elements having no effect on the text the HTML parser extracts */
+static const gchar *html_inline_elements [] = {
+	"a", "abbr", "b", "big", "br", "cite", "code", "del", "div", "em", "font",
+	"i", "img", "ins", "p", "q", "s", "small", "span", "strike", "strong",
+	"sub", "sup", "tt", "u", NULL
+};
+
+#define HTML_INLINE_ELEMENT_MAX	6
+
+#define IS_TEXT_BLANK(__c)		((__c) == ' ' || (__c) == '\t' || (__c) == '\n')
+
+static int
+html_entities_compare (const void *a, const void *b)
+{
+	return strcmp (((const HtmlEntity*) a)->name, ((const HtmlEntity*) b)->name);
+}
+
+/*
+ * Skips the tag at @pos, returning the position following it or NULL if it
+ * is something to be handled by the real parser
+ */
+static const gchar*
+quick_skip_tag (const gchar *pos)
+{
+	int i;
+	int len;
+	gchar name [HTML_INLINE_ELEMENT_MAX + 1];
+	gchar quote;
+	gchar prev;
+
+	pos++;
+	if (*pos == '/')
+		pos++;
+
+	for (len = 0; len <= HTML_INLINE_ELEMENT_MAX && g_ascii_isalnum (pos [len]); len++)
+		name [len] = g_ascii_tolower (pos [len]);
+
+	if (len == 0 || len > HTML_INLINE_ELEMENT_MAX)
+		return NULL;
+
+	name [len] = '\0';
+
+	for (i = 0; html_inline_elements [i] != NULL; i++)
+		if (strcmp (html_inline_elements [i], name) == 0)
+			break;
+
+	if (html_inline_elements [i] == NULL)
+		return NULL;
+
+	pos += len;
+	if (*pos != '>' && *pos != '/' && !IS_TEXT_BLANK (*pos))
+		return NULL;
+
+	quote = '\0';
+	prev = '\0';
+
+	for (; *pos != '\0'; pos++) {
+		if (quote != '\0') {
+			if (*pos == quote)
+				quote = '\0';
+		}
+		else if (*pos == '"' || *pos == '\'') {
+			if (prev != '=')
+				return NULL;
+			quote = *pos;
+		}
+		else if (*pos == '>') {
+			return pos + 1;
+		}
+		else if (*pos == '<') {
+			return NULL;
+		}
+
+		if (!IS_TEXT_BLANK (*pos))
+			prev = *pos;
+	}
+
+	return NULL;
+}
+
+/*
+ * Decodes the entity or character reference at @pos into @out. Returns the
+ * position following it, or NULL if it is something to be handled by the
+ * real parser. Incomplete entities are copied as they are
+ */
+static const gchar*
+quick_decode_entity (const gchar *pos, gchar **out)
+{
+	int len;
+	int base;
+	gunichar value;
+	gchar name [HTML_ENTITY_NAME_MAX + 1];
+	HtmlEntity key;
+	HtmlEntity *found;
+
+	if (pos [1] == '#') {
+		value = 0;
+		pos += 2;
+
+		if (*pos == 'x' || *pos == 'X') {
+			base = 16;
+			pos++;
+		}
+		else {
+			base = 10;
+		}
+
+		for (len = 0; g_ascii_isxdigit (*pos) && (base == 16 || g_ascii_isdigit (*pos)); len++, pos++) {
+			if (len == 7)
+				return NULL;
+			value = value * base + g_ascii_xdigit_value (*pos);
+		}
+
+		/* the same check of IS_CHAR() */
+		if (len == 0 || *pos != ';' ||
+		    !((value >= 0x20 && value <= 0xD7FF) || value == 0x9 || value == 0xA || value == 0xD ||
+		      (value >= 0xE000 && value <= 0xFFFD) || (value >= 0x10000 && value <= 0x10FFFF)))
+			return NULL;
+
+		*out += g_unichar_to_utf8 (value, *out);
+		return pos + 1;
+	}
+
+	if (pos [1] == '\0')
+		return NULL;
+
+	if (!g_ascii_isalpha (pos [1])) {
+		**out = '&';
+		(*out)++;
+		return pos + 1;
+	}
+
+	for (len = 1; g_ascii_isalnum (pos [len]); len++);
+
+	if (pos [len] == '.' || pos [len] == '-' || pos [len] == '_' || pos [len] == ':')
+		return NULL;
+
+	if (pos [len] != ';') {
+		memcpy (*out, pos, len);
+		*out += len;
+		return pos + len;
+	}
+
+	if (len - 1 > HTML_ENTITY_NAME_MAX)
+		return NULL;
+
+	memcpy (name, pos + 1, len - 1);
+	name [len - 1] = '\0';
+	key.name = name;
+
+	found = bsearch (&key, html_entities, G_N_ELEMENTS (html_entities), sizeof (HtmlEntity), html_entities_compare);
+	if (found == NULL)
+		return NULL;
+
+	*out += g_unichar_to_utf8 (found->value, *out);
+	return pos + len + 1;
+}
+
+/*
+ * Strips tags and decodes entities of @string in a single pass, into a
+ * buffer allocated once. This gives the same results of the HTML parser for
+ * the simple strings usually found in titles; FALSE is returned for
+ * anything else (comments, scripts, unknown entities...)
+ */
+static gboolean
+quick_unhtmlize (const gchar *string, gchar **result)
+{
+	const gchar *pos;
+	const gchar *segment;
+	gchar *buffer;
+	gchar *out;
+
+	/* decoded entities are never longer than their source */
+	buffer = g_malloc (strlen (string) + 1);
+	out = buffer;
+
+	/* leading blanks are skipped by the HTML parser */
+	pos = string;
+	while (IS_TEXT_BLANK (*pos))
+		pos++;
+
+	/* a leading closing tag makes the HTML parser discard everything */
+	if (pos [0] == '<' && pos [1] == '/') {
+		g_free (buffer);
+		return FALSE;
+	}
+
+	while (*pos != '\0') {
+		if (*pos == '<')
+			pos = quick_skip_tag (pos);
+		else if (*pos == '&')
+			pos = quick_decode_entity (pos, &out);
+		else {
+			for (segment = pos; *pos != '\0' && *pos != '<' && *pos != '&' && *pos != '\r'; pos++);
+
+			memcpy (out, segment, pos - segment);
+			out += pos - segment;
+
+			if (*pos == '\r')
+				pos = NULL;
+		}
+
+		if (pos == NULL) {
+			g_free (buffer);
+			return FALSE;
+		}
+	}
+
+	*out = '\0';
+	*result = buffer;
+	return TRUE;
+}
+
 static gchar*
 unmarkupize (gchar *string, void(*parse)(gchar *string, ResultBuffer *buffer))
 {
@@ -92,7 +347,7 @@ unmarkupize (gchar *string, void(*parse)(gchar *string, ResultBuffer *buffer))
 	result = buffer->data;
 	g_free (buffer);
 
- 	if (result == NULL || !g_utf8_strlen (result, -1)) {
+ 	if (result == NULL || result [0] == '\0') {
 		g_free (result);
  		return string;
  	}
@@ -105,41 +360,55 @@ unmarkupize (gchar *string, void(*parse)(gchar *string, ResultBuffer *buffer))
 gchar*
 unhtmlize (gchar *string)
 {
-	return unmarkupize (string, _unhtmlize);
+	gchar *result;
+
+	if (string == NULL || strpbrk (string, "&<>") == NULL)
+		return string;
+
+	if (quick_unhtmlize (string, &result) == FALSE)
+		return unmarkupize (string, _unhtmlize);
+
+	if (result [0] == '\0') {
+		g_free (result);
+		return string;
+	}
+	else {
+		g_free (string);
+		return result;
+	}
 }
 
 gchar*
 unxmlize (gchar * string)
 {
+	const gchar *pos;
+
+	if (string == NULL)
+		return NULL;
+
+	/* the XML parser emits nothing, and the string is returned as it
+	   is, if that does not begin with some markup */
+	for (pos = string; IS_TEXT_BLANK (*pos) || *pos == '\r'; pos++);
+	if (*pos != '<')
+		return string;
+
 	return unmarkupize (string, _unxmlize);
 }
 
 static xmlNodePtr
 xhtml_find_body (xmlDocPtr doc)
 {
-	xmlXPathContextPtr xpathCtxt = NULL;
-	xmlXPathObjectPtr xpathObj = NULL;
-	xmlNodePtr node = NULL;
-
-	xpathCtxt = xmlXPathNewContext (doc);
-	if (!xpathCtxt)
-		goto error;
-
-	xpathObj = xmlXPathEvalExpression (BAD_CAST"/html/body", xpathCtxt);
-	if (!xpathObj)
-		goto error;
-	if (!xpathObj->nodesetval->nodeMax)
-		goto error;
+	xmlNodePtr node;
 
-	node = xpathObj->nodesetval->nodeTab[0];
+	node = xmlDocGetRootElement (doc);
+	if (node == NULL || node->ns != NULL || !xmlStrEqual (node->name, BAD_CAST"html"))
+		return NULL;
 
-error:
-	if (xpathObj)
-		xmlXPathFreeObject (xpathObj);
-	if (xpathCtxt)
-		xmlXPathFreeContext (xpathCtxt);
+	for (node = node->children; node; node = node->next)
+		if (node->type == XML_ELEMENT_NODE && node->ns == NULL && xmlStrEqual (node->name, BAD_CAST"body"))
+			return node;
 
-	return node;
+	return NULL;
 }
 
 static xmlDocPtr
@@ -157,359 +426,2110 @@ xhtml_parse (const gchar *html, gint len)
 	return out;
 }
 
-gchar*
-xhtml_extract (xmlNodePtr xml, gint xhtmlMode, const gchar *defaultBase)
+/*
+	The functions below serialize nodes exactly as xmlNodeDump() does for
+	a copy of them, placed into a new document, without having to build
+	it
+*/
+
+static void
+xhtml_dump_text (GString *out, const xmlChar *text)
 {
-	xmlBufferPtr buf;
-	xmlChar *xml_base = NULL;
-	gchar *result = NULL;
-	xmlNs *ns;
+	const gchar *rep;
+	const xmlChar *start;
+	const xmlChar *pos;
+
+	for (start = pos = text; *pos != '\0'; pos++) {
+		switch (*pos) {
+			case '<':
+				rep = "&lt;";
+				break;
+			case '>':
+				rep = "&gt;";
+				break;
+			case '&':
+				rep = "&amp;";
+				break;
+			case '\r':
+				rep = "&#13;";
+				break;
+			default:
+				continue;
+		}
 
-	/* Create the new document and add the div tag*/
-	xmlDocPtr newDoc = xmlNewDoc (BAD_CAST "1.0" );
-	xmlNodePtr divNode = xmlNewNode (NULL, BAD_CAST "div");
-	xmlDocSetRootElement (newDoc, divNode);
-	xmlNewNs (divNode, BAD_CAST "http://www.w3.org/1999/xhtml", NULL);
+		g_string_append_len (out, (const gchar*) start, pos - start);
+		g_string_append (out, rep);
+		start = pos + 1;
+	}
 
-	/* Set the xml:base  of the div tag */
-	xml_base = xmlNodeGetBase (xml->doc, xml);
-	if (xml_base) {
-		xmlNodeSetBase (divNode, xml_base );
-		xmlFree (xml_base);
+	g_string_append_len (out, (const gchar*) start, pos - start);
+}
+
+static void
+xhtml_dump_attribute_value (GString *out, const xmlChar *text)
+{
+	int len;
+	gunichar val;
+	const gchar *rep;
+	const xmlChar *start;
+	const xmlChar *pos;
+
+	for (start = pos = text; *pos != '\0'; pos++) {
+		switch (*pos) {
+			case '<':
+				rep = "&lt;";
+				break;
+			case '>':
+				rep = "&gt;";
+				break;
+			case '&':
+				rep = "&amp;";
+				break;
+			case '"':
+				rep = "&quot;";
+				break;
+			case '\n':
+				rep = "&#10;";
+				break;
+			case '\r':
+				rep = "&#13;";
+				break;
+			case '\t':
+				rep = "&#9;";
+				break;
+			default:
+				rep = NULL;
+				break;
+		}
+
+		if (rep != NULL) {
+			g_string_append_len (out, (const gchar*) start, pos - start);
+			g_string_append (out, rep);
+			start = pos + 1;
+		}
+		else if (*pos >= 0x80 && pos [1] != '\0') {
+			/* the new document would have no encoding, so non
+			   ASCII characters are written as references */
+			g_string_append_len (out, (const gchar*) start, pos - start);
+
+			len = 1;
+			val = *pos;
+
+			if (*pos >= 0xC0 && *pos < 0xE0) {
+				val = ((pos [0] & 0x1F) << 6) | (pos [1] & 0x3F);
+				len = 2;
+			}
+			else if (*pos >= 0xE0 && *pos < 0xF0 && pos [2] != '\0') {
+				val = ((pos [0] & 0x0F) << 12) | ((pos [1] & 0x3F) << 6) | (pos [2] & 0x3F);
+				len = 3;
+			}
+			else if (*pos >= 0xF0 && *pos < 0xF8 && pos [2] != '\0' && pos [3] != '\0') {
+				val = ((pos [0] & 0x07) << 18) | ((pos [1] & 0x3F) << 12) | ((pos [2] & 0x3F) << 6) | (pos [3] & 0x3F);
+				len = 4;
+			}
+
+			if (len == 1 || !xmlIsCharQ (val)) {
+				val = *pos;
+				len = 1;
+			}
+
+			g_string_append_printf (out, "&#x%X;", val);
+			pos += len - 1;
+			start = pos + 1;
+		}
 	}
-	else if (defaultBase)
-		xmlNodeSetBase (divNode, BAD_CAST defaultBase);
 
-	if (xhtmlMode == 0) { /* Read escaped HTML and convert to XHTML, placing in a div tag */
-		xmlDocPtr oldDoc;
-		xmlNodePtr copiedNodes = NULL;
-		xmlChar *escapedhtml;
-
-		/* Parse the HTML into oldDoc*/
-		escapedhtml = xmlNodeListGetString (xml->doc, xml->xmlChildrenNode, 1);
-		if (escapedhtml) {
-			escapedhtml = BAD_CAST g_strstrip ((gchar*) escapedhtml);	/* stripping whitespaces to make empty string detection easier */
-			if (*escapedhtml) {						/* never process empty content, xmlDocCopy() doesn't like it... */
-				xmlNodePtr body;
-				oldDoc = xhtml_parse ((gchar*) escapedhtml, strlen ((gchar*) escapedhtml));
-				body = xhtml_find_body (oldDoc);
-
-				/* Copy namespace from original documents root node. This is
-				   ro determine additional namespaces for item content. For
-				   example to handle RSS 2.0 feeds as provided by LiveJournal:
-
-				   <rss version='2.0' xmlns:lj='http://www.livejournal.org/rss/lj/1.0/'>
-				   <channel>
-				      ...
-				      <item>
-	        			 ...
-  	        			 <description>... &lt;span class=&apos;ljuser&apos; lj:user=&apos;someone&apos; style=&apos;white-space: nowrap;&apos;&gt;&lt;a href=&apos;http://community.livejournal.com/someone/profile&apos;&gt;&lt;img src=&apos;http://stat.livejournal.com/img/community.gif&apos; alt=&apos;[info]&apos; width=&apos;16&apos; height=&apos;16&apos; style=&apos;vertical-align: bottom; border: 0; padding-right: 2px;&apos; /&gt;&lt;/a&gt;&lt;a href=&apos;http://community.livejournal.com/someone/&apos;&gt;&lt;b&gt;someone&lt;/b&gt;&lt;/a&gt;&lt;/span&gt; ...</description>
-					 ...
-				      </item>
-				      ...
-				   </channel>
-
-				   Then we will want to extract <description> and need to
-				   honour the xmlns:lj definition...
-				*/
-				ns = (xmlDocGetRootElement (xml->doc))->nsDef;
-				while (ns) {
-					xmlNewNs (divNode, ns->href, ns->prefix);
-					ns = ns->next;
+	g_string_append_len (out, (const gchar*) start, pos - start);
+}
+
+static void
+xhtml_dump_quoted (GString *out, const xmlChar *text)
+{
+	const xmlChar *pos;
+
+	if (strchr ((const gchar*) text, '"') == NULL) {
+		g_string_append_c (out, '"');
+		g_string_append (out, (const gchar*) text);
+		g_string_append_c (out, '"');
+	}
+	else if (strchr ((const gchar*) text, '\'') == NULL) {
+		g_string_append_c (out, '\'');
+		g_string_append (out, (const gchar*) text);
+		g_string_append_c (out, '\'');
+	}
+	else {
+		g_string_append_c (out, '"');
+
+		for (pos = text; *pos != '\0'; pos++) {
+			if (*pos == '"')
+				g_string_append (out, "&quot;");
+			else
+				g_string_append_c (out, *pos);
+		}
+
+		g_string_append_c (out, '"');
+	}
+}
+
+static void
+xhtml_dump_ns (GString *out, xmlNsPtr ns)
+{
+	if (ns->href == NULL || xmlStrEqual (ns->prefix, BAD_CAST"xml"))
+		return;
+
+	if (ns->prefix != NULL) {
+		g_string_append (out, " xmlns:");
+		g_string_append (out, (const gchar*) ns->prefix);
+	}
+	else {
+		g_string_append (out, " xmlns");
+	}
+
+	g_string_append_c (out, '=');
+	xhtml_dump_quoted (out, ns->href);
+}
+
+static void
+xhtml_dump_qname (GString *out, xmlNsPtr ns, const xmlChar *name)
+{
+	if (ns != NULL && ns->prefix != NULL) {
+		g_string_append (out, (const gchar*) ns->prefix);
+		g_string_append_c (out, ':');
+	}
+
+	g_string_append (out, (const gchar*) name);
+}
+
+static void
+xhtml_dump_node (GString *out, xmlNodePtr node, GPtrArray *extra_ns)
+{
+	guint i;
+	xmlNsPtr ns;
+	xmlAttrPtr attr;
+	xmlNodePtr child;
+	const xmlChar *start;
+	const xmlChar *end;
+
+	switch (node->type) {
+		case XML_ELEMENT_NODE:
+			g_string_append_c (out, '<');
+			xhtml_dump_qname (out, node->ns, node->name);
+
+			for (ns = node->nsDef; ns; ns = ns->next)
+				xhtml_dump_ns (out, ns);
+
+			if (extra_ns != NULL)
+				for (i = 0; i < extra_ns->len; i++)
+					xhtml_dump_ns (out, g_ptr_array_index (extra_ns, i));
+
+			for (attr = node->properties; attr; attr = attr->next) {
+				g_string_append_c (out, ' ');
+				xhtml_dump_qname (out, attr->ns, attr->name);
+				g_string_append (out, "=\"");
+
+				for (child = attr->children; child; child = child->next) {
+					if (child->type == XML_TEXT_NODE && child->content != NULL) {
+						xhtml_dump_attribute_value (out, child->content);
+					}
+					else if (child->type == XML_ENTITY_REF_NODE) {
+						g_string_append_c (out, '&');
+						g_string_append (out, (const gchar*) child->name);
+						g_string_append_c (out, ';');
+					}
 				}
 
-				if (body) {
-					/* Copy in the html tags */
-					copiedNodes = xmlDocCopyNodeList (newDoc, body->xmlChildrenNode);
-					// FIXME: is the above correct? Why only operate on the first child node?
-					// It might be unproblematic because all content is wrapped in a <div>...
-					xmlAddChildList (divNode, copiedNodes);
+				g_string_append_c (out, '"');
+			}
+
+			if (node->children == NULL) {
+				g_string_append (out, "/>");
+			}
+			else {
+				g_string_append_c (out, '>');
+
+				for (child = node->children; child; child = child->next)
+					xhtml_dump_node (out, child, NULL);
+
+				g_string_append (out, "</");
+				xhtml_dump_qname (out, node->ns, node->name);
+				g_string_append_c (out, '>');
+			}
+
+			break;
+
+		case XML_TEXT_NODE:
+			if (node->content == NULL)
+				break;
+
+			if (node->name == xmlStringTextNoenc)
+				g_string_append (out, (const gchar*) node->content);
+			else
+				xhtml_dump_text (out, node->content);
+
+			break;
+
+		case XML_CDATA_SECTION_NODE:
+			if (node->content == NULL || *node->content == '\0') {
+				g_string_append (out, "<![CDATA[]]>");
+				break;
+			}
+
+			/* "]]>" sequences are splitted among sections */
+			for (start = end = node->content; *end != '\0'; end++) {
+				if (end [0] == ']' && end [1] == ']' && end [2] == '>') {
+					end += 2;
+					g_string_append (out, "<![CDATA[");
+					g_string_append_len (out, (const gchar*) start, end - start);
+					g_string_append (out, "]]>");
+					start = end;
 				}
-				xmlFreeDoc (oldDoc);
-				xmlFree (escapedhtml);
 			}
+
+			if (start != end) {
+				g_string_append (out, "<![CDATA[");
+				g_string_append (out, (const gchar*) start);
+				g_string_append (out, "]]>");
+			}
+
+			break;
+
+		case XML_COMMENT_NODE:
+			if (node->content != NULL) {
+				g_string_append (out, "<!--");
+				g_string_append (out, (const gchar*) node->content);
+				g_string_append (out, "-->");
+			}
+
+			break;
+
+		case XML_ENTITY_REF_NODE:
+			g_string_append_c (out, '&');
+			g_string_append (out, (const gchar*) node->name);
+			g_string_append_c (out, ';');
+			break;
+
+		case XML_PI_NODE:
+			g_string_append (out, "<?");
+			g_string_append (out, (const gchar*) node->name);
+
+			if (node->content != NULL) {
+				g_string_append_c (out, ' ');
+				g_string_append (out, (const gchar*) node->content);
+			}
+
+			g_string_append (out, "?>");
+			break;
+
+		default:
+			break;
+	}
+}
+
+static void
+xhtml_check_ns (xmlNodePtr top, xmlNodePtr node, xmlNsPtr ns, GPtrArray **extra_ns)
+{
+	guint i;
+	xmlNsPtr iter;
+
+	if (xmlStrEqual (ns->prefix, BAD_CAST"xml"))
+		return;
+
+	for (;; node = node->parent) {
+		for (iter = node->nsDef; iter; iter = iter->next)
+			if (xmlStrEqual (iter->prefix, ns->prefix))
+				return;
+
+		if (node == top)
+			break;
+	}
+
+	if (*extra_ns == NULL)
+		*extra_ns = g_ptr_array_new ();
+
+	for (i = 0; i < (*extra_ns)->len; i++)
+		if (xmlStrEqual (((xmlNsPtr) g_ptr_array_index (*extra_ns, i))->prefix, ns->prefix))
+			return;
+
+	g_ptr_array_add (*extra_ns, ns);
+}
+
+/*
+	When copied, elements using a namespace declared outside the copied
+	tree get a new declaration on the topmost element: here those are
+	collected, to be written while serializing @top
+*/
+static void
+xhtml_collect_ns (xmlNodePtr top, xmlNodePtr node, GPtrArray **extra_ns)
+{
+	xmlAttrPtr attr;
+	xmlNodePtr child;
+
+	if (node->type != XML_ELEMENT_NODE)
+		return;
+
+	if (node->ns != NULL)
+		xhtml_check_ns (top, node, node->ns, extra_ns);
+
+	for (attr = node->properties; attr; attr = attr->next)
+		if (attr->ns != NULL)
+			xhtml_check_ns (top, node, attr->ns, extra_ns);
+
+	for (child = node->children; child; child = child->next)
+		xhtml_collect_ns (top, child, extra_ns);
+}
+
+static void
+xhtml_dump_base_url (GString *out, const xmlChar *base)
+{
+	xmlChar *fixed_base;
+
+	/* Set the xml:base  of the div tag */
+	if (base) {
+		fixed_base = xmlPathToURI (base);
+		g_string_append (out, " xml:base=\"");
+		xhtml_dump_attribute_value (out, fixed_base ? fixed_base : base);
+		g_string_append_c (out, '"');
+		xmlFree (fixed_base);
+	}
+}
+
+static void
+xhtml_dump_base (GString *out, xmlNodePtr xml, const gchar *defaultBase)
+{
+	xmlChar *xml_base;
+
+	xml_base = xmlNodeGetBase (xml->doc, xml);
+	xhtml_dump_base_url (out, xml_base ? xml_base : BAD_CAST defaultBase);
+	xmlFree (xml_base);
+}
+
+/*
+	Declarations of the prefixed namespaces of the root of @doc, as placed
+	in the div tag wrapping escaped HTML, or NULL if there are none
+*/
+gchar*
+xhtml_root_namespaces (xmlDocPtr doc)
+{
+	GString *out;
+	xmlNs *ns;
+
+	/* Copy namespace from original documents root node. This is
+	   ro determine additional namespaces for item content. For
+	   example to handle RSS 2.0 feeds as provided by LiveJournal:
+
+	   <rss version='2.0' xmlns:lj='http://www.livejournal.org/rss/lj/1.0/'>
+	   <channel>
+	      ...
+	      <item>
+        			 ...
+  	        		 <description>... &lt;span class=&apos;ljuser&apos; lj:user=&apos;someone&apos; style=&apos;white-space: nowrap;&apos;&gt;&lt;a href=&apos;http://community.livejournal.com/someone/profile&apos;&gt;&lt;img src=&apos;http://stat.livejournal.com/img/community.gif&apos; alt=&apos;[info]&apos; width=&apos;16&apos; height=&apos;16&apos; style=&apos;vertical-align: bottom; border: 0; padding-right: 2px;&apos; /&gt;&lt;/a&gt;&lt;a href=&apos;http://community.livejournal.com/someone/&apos;&gt;&lt;b&gt;someone&lt;/b&gt;&lt;/a&gt;&lt;/span&gt; ...</description>
+		 ...
+	      </item>
+	      ...
+	   </channel>
+
+	   Then we will want to extract <description> and need to
+	   honour the xmlns:lj definition...
+
+	   The default namespace is always the XHTML one.
+	*/
+	out = NULL;
+
+	for (ns = (xmlDocGetRootElement (doc))->nsDef; ns; ns = ns->next) {
+		if (ns->prefix != NULL) {
+			if (out == NULL)
+				out = g_string_sized_new (128);
+			xhtml_dump_ns (out, ns);
+		}
+	}
+
+	return (out != NULL ? g_string_free (out, FALSE) : NULL);
+}
+
+/*
+	Base URL of the escaped HTML in @xml, as an interned string. When no
+	xml:base is found up to the root the URL of the document applies, and
+	no new string is built
+*/
+gchar*
+xhtml_lazy_base (xmlNodePtr xml, const gchar *defaultBase)
+{
+	gchar *ret;
+	xmlChar *xml_base;
+	xmlNodePtr scope;
+
+	for (scope = xml; scope != NULL && scope->type == XML_ELEMENT_NODE; scope = scope->parent)
+		if (xmlHasNsProp (scope, BAD_CAST"base", XML_XML_NAMESPACE) != NULL)
+			break;
+
+	if (scope == NULL || scope->type != XML_ELEMENT_NODE)
+		return intern_string (xml->doc->URL ? (const gchar*) xml->doc->URL : defaultBase);
+
+	xml_base = xmlNodeGetBase (xml->doc, xml);
+	ret = intern_string (xml_base ? (const gchar*) xml_base : defaultBase);
+	xmlFree (xml_base);
+	return ret;
+}
+
+/*
+	Converts the escaped @html, which is stripped in place, and places it
+	in a div tag with the namespaces obtained from xhtml_root_namespaces()
+	and the @base. This is xhtml_extract() in mode 0, split to let items
+	keep just its inputs until their description is requested
+*/
+gchar*
+xhtml_render_lazy (const gchar *namespaces, const gchar *base, gchar *html)
+{
+	GString *out;
+	xmlDocPtr oldDoc;
+	xmlNodePtr body;
+	xmlNodePtr iter;
+
+	out = g_string_sized_new (256);
+	g_string_append (out, "<div xmlns=\"http://www.w3.org/1999/xhtml\"");
+
+	/* stripping whitespaces to make empty string detection easier */
+	if (html != NULL && *g_strstrip (html) == '\0')
+		html = NULL;
+
+	/* never process empty content */
+	if (html != NULL && namespaces != NULL)
+		g_string_append (out, namespaces);
+
+	xhtml_dump_base_url (out, BAD_CAST base);
+
+	if (html == NULL) {
+		g_string_append (out, "/>");
+		return g_string_free (out, FALSE);
+	}
+
+	/* Parse the HTML into oldDoc*/
+	oldDoc = xhtml_parse (html, strlen (html));
+	body = xhtml_find_body (oldDoc);
+
+	if (body == NULL || body->xmlChildrenNode == NULL) {
+		g_string_append (out, "/>");
+	}
+	else {
+		g_string_append_c (out, '>');
+
+		for (iter = body->xmlChildrenNode; iter; iter = iter->next)
+			xhtml_dump_node (out, iter, NULL);
+
+		g_string_append (out, "</div>");
+	}
+
+	if (oldDoc)
+		xmlFreeDoc (oldDoc);
+
+	return g_string_free (out, FALSE);
+}
+
+gchar*
+xhtml_extract (xmlNodePtr xml, gint xhtmlMode, const gchar *defaultBase)
+{
+	gchar *html;
+	gchar *namespaces;
+	gchar *ret;
+	xmlChar *base;
+	GString *out;
+	GPtrArray *extra_ns;
+	xmlNodePtr children = NULL;
+	xmlNodePtr iter;
+
+	if (xhtmlMode == 0) { /* Read escaped HTML and convert to XHTML, placing in a div tag */
+		html = (gchar*) xmlNodeListGetString (xml->doc, xml->xmlChildrenNode, 1);
+		namespaces = (html != NULL ? xhtml_root_namespaces (xml->doc) : NULL);
+		base = xmlNodeGetBase (xml->doc, xml);
+
+		ret = xhtml_render_lazy (namespaces, base ? (const gchar*) base : defaultBase, html);
+		g_free (namespaces);
+		xmlFree (base);
+		xmlFree (html);
+		return ret;
+	}
+
+	/* Content is placed in a div tag, directly serialized */
+	out = g_string_sized_new (256);
+	g_string_append (out, "<div xmlns=\"http://www.w3.org/1999/xhtml\"");
+
+	if (xhtmlMode == 1 || xhtmlMode == 2) /* Read multiple XHTML tags and embed in div tag */
+		children = xml->xmlChildrenNode;
+
+	xhtml_dump_base (out, xml, defaultBase);
+
+	if (children == NULL) {
+		g_string_append (out, "/>");
+	}
+	else {
+		g_string_append_c (out, '>');
+
+		for (iter = children; iter; iter = iter->next) {
+			extra_ns = NULL;
+			xhtml_collect_ns (iter, iter, &extra_ns);
+			xhtml_dump_node (out, iter, extra_ns);
+
+			if (extra_ns)
+				g_ptr_array_free (extra_ns, TRUE);
+		}
+
+		g_string_append (out, "</div>");
+	}
+
+	return g_string_free (out, FALSE);
+}
+
+/*
+	Table of interned strings, shared by the whole library. Each string is
+	allocated after its own reference counter, so that it can be released
+	without a lookup, and is removed from the table once the last
+	reference is dropped.
+	The table is split in shards, each with its own lock, so that the
+	workers of grss_feed_parser_parse_many() do not queue on a single one.
+	The hash of the string selects the shard, and is kept beside the
+	counter to find it again on release
+*/
+#define INTERNED_SHARDS		16
+
+typedef struct {
+	guint	hash;
+	gint	ref_count;
+	gchar	string [1];
+} InternedString;
+
+typedef struct {
+	GHashTable	*table;
+	GMutex		lock;
+} InternedShard;
+
+static InternedShard interned_shards [INTERNED_SHARDS];
+
+#define INTERNED_STRING(__str)	((InternedString*) ((__str) - G_STRUCT_OFFSET (InternedString, string)))
+
+gchar*
+intern_string (const gchar *string)
+{
+	gsize len;
+	guint hash;
+	InternedShard *shard;
+	InternedString *interned;
+
+	if (string == NULL)
+		return NULL;
+
+	hash = g_str_hash (string);
+	shard = &interned_shards [hash % INTERNED_SHARDS];
+
+	g_mutex_lock (&shard->lock);
+
+	if (shard->table == NULL)
+		shard->table = g_hash_table_new (g_str_hash, g_str_equal);
+
+	interned = g_hash_table_lookup (shard->table, string);
+
+	if (interned == NULL) {
+		len = strlen (string);
+		interned = g_malloc (G_STRUCT_OFFSET (InternedString, string) + len + 1);
+		interned->hash = hash;
+		interned->ref_count = 1;
+		memcpy (interned->string, string, len + 1);
+		g_hash_table_insert (shard->table, interned->string, interned);
+	}
+	else {
+		interned->ref_count++;
+	}
+
+	g_mutex_unlock (&shard->lock);
+	return interned->string;
+}
+
+gchar*
+ref_string (gchar *string)
+{
+	InternedShard *shard;
+	InternedString *interned;
+
+	if (string == NULL)
+		return NULL;
+
+	interned = INTERNED_STRING (string);
+	shard = &interned_shards [interned->hash % INTERNED_SHARDS];
+
+	g_mutex_lock (&shard->lock);
+	interned->ref_count++;
+	g_mutex_unlock (&shard->lock);
+
+	return string;
+}
+
+void
+release_string (gchar *string)
+{
+	InternedShard *shard;
+	InternedString *interned;
+
+	if (string == NULL)
+		return;
+
+	interned = INTERNED_STRING (string);
+	shard = &interned_shards [interned->hash % INTERNED_SHARDS];
+
+	g_mutex_lock (&shard->lock);
+
+	interned->ref_count--;
+	if (interned->ref_count == 0) {
+		g_hash_table_remove (shard->table, interned->string);
+		g_free (interned);
+	}
+
+	g_mutex_unlock (&shard->lock);
+}
+
+/*
+	Just to suppress output from libxml2
+*/
+void
+error_func (void * ctx, const char * msg, ...)
+{
+	return;
+}
+
+/*
+	Errors of the parsing are suppressed with the options of the
+	context, which are local to the call. The generic handler is still
+	set for errors raised outside a context: that is a per-thread setting
+	in libxml2, so this is safe to call from many threads
+*/
+#define XML_QUIET_OPTIONS	(XML_PARSE_NOERROR | XML_PARSE_NOWARNING)
+
+/*
+	Each thread keeps its own parser context, reset (SAX handler included)
+	and reused for every document, so that the input buffers and the dictionary of names
+	(shared by all the documents built with the context) are allocated
+	only once. When the dictionary grows too much, due to feeds using
+	plenty of different names, the context is replaced.
+	Lookups in a libxml2 dictionary are not locked, so it is not shared
+	among threads: each document takes its own reference to the
+	dictionary of the context when it is started, and keeps it alive
+	after the context is replaced or its thread exits. Since the
+	dictionary is also accessed when the document is freed, a document
+	read by content_to_xml() or file_to_xml() has to be freed by the same
+	thread that read it
+*/
+#define XML_DICT_MAX_SIZE	8192
+
+static void
+free_parser_context (gpointer ctxt)
+{
+	xmlFreeParserCtxt (ctxt);
+}
+
+static GPrivate parser_context = G_PRIVATE_INIT (free_parser_context);
+
+static xmlParserCtxtPtr
+get_parser_context ()
+{
+	xmlParserCtxtPtr ctxt;
+
+	ctxt = g_private_get (&parser_context);
+
+	if (ctxt != NULL && ctxt->dict != NULL && xmlDictSize (ctxt->dict) > XML_DICT_MAX_SIZE)
+		ctxt = NULL;
+
+	if (ctxt == NULL) {
+		ctxt = xmlNewParserCtxt ();
+		g_private_replace (&parser_context, ctxt);
+	}
+
+	/* options as XML_PARSE_NOBLANKS and XML_PARSE_NOCDATA alter the handler */
+	if (ctxt != NULL)
+		xmlSAXVersion (ctxt->sax, 2);
+
+	return ctxt;
+}
+
+/*
+	Limits are enforced wrapping the SAX callbacks used to build the
+	tree: as soon as one is exceeded the parser is stopped, so a hostile
+	document costs no more than allowed
+*/
+typedef struct {
+	const GrssFeedParserLimits *limits;
+	xmlSAXHandler sax;
+
+	guint depth;
+	guint nodes;
+	gsize text;
+	guint entities;
+	gint64 deadline;
+	const gchar *exceeded;
+
+	/* hooks of a XmlPushReader, see xml_push_reader_set_element_func() */
+	XmlPushElementFunc element_func;
+	gpointer element_data;
+	xmlNodePtr dropped;
+} XmlLimitsGuard;
+
+/* the clock is checked once every XML_LIMITS_CLOCK_STEP nodes */
+#define XML_LIMITS_CLOCK_STEP	64
+
+static void
+limits_stop (xmlParserCtxtPtr ctxt, XmlLimitsGuard *guard, const gchar *what)
+{
+	guard->exceeded = what;
+	xmlStopParser (ctxt);
+}
+
+static gboolean
+limits_check_time (xmlParserCtxtPtr ctxt, XmlLimitsGuard *guard)
+{
+	if (guard->deadline != 0 && g_get_monotonic_time () > guard->deadline) {
+		limits_stop (ctxt, guard, "parse time");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+	Nodes dropped from the tree no longer count towards the limits on the
+	number of nodes and on the text size, which so bound the part of the
+	document held in memory at once
+*/
+static void
+limits_forget (XmlLimitsGuard *guard, xmlNodePtr node)
+{
+	gsize len;
+	xmlAttrPtr attr;
+	xmlNodePtr iter;
+
+	if (node->type == XML_ELEMENT_NODE) {
+		guard->nodes = (guard->nodes > 0 ? guard->nodes - 1 : 0);
+
+		for (attr = node->properties; attr != NULL; attr = attr->next)
+			for (iter = attr->children; iter != NULL; iter = iter->next)
+				limits_forget (guard, iter);
+
+		for (iter = node->children; iter != NULL; iter = iter->next)
+			limits_forget (guard, iter);
+	}
+	else if ((node->type == XML_TEXT_NODE || node->type == XML_CDATA_SECTION_NODE) && node->content != NULL) {
+		len = xmlStrlen (node->content);
+		guard->text = (guard->text > len ? guard->text - len : 0);
+	}
+}
+
+/*
+	The dropped element is freed only once the parser has moved to the next
+	one, together with the blanks in between: libxml2 may still append text
+	to the last child of the current node
+*/
+static void
+limits_release_dropped (XmlLimitsGuard *guard)
+{
+	xmlNodePtr node;
+	xmlNodePtr next;
+
+	node = guard->dropped;
+	guard->dropped = NULL;
+
+	do {
+		next = node->next;
+		limits_forget (guard, node);
+		xmlUnlinkNode (node);
+		xmlFreeNode (node);
+		node = next;
+	} while (node != NULL && xmlIsBlankNode (node));
+}
+
+static gboolean limits_add_text (xmlParserCtxtPtr ctxt, XmlLimitsGuard *guard, gsize len);
+
+/* each attribute is described by five pointers, the last two delimiting its value */
+static gsize
+limits_attributes_size (int nb_attributes, const xmlChar **attributes)
+{
+	int i;
+	gsize ret;
+
+	ret = 0;
+
+	for (i = 0; i < nb_attributes; i++)
+		ret += attributes [i * 5 + 4] - attributes [i * 5 + 3];
+
+	return ret;
+}
+
+static void
+limits_start_element (void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI,
+                      int nb_namespaces, const xmlChar **namespaces, int nb_attributes, int nb_defaulted,
+                      const xmlChar **attributes)
+{
+	xmlParserCtxtPtr ctxt;
+	XmlLimitsGuard *guard;
+
+	ctxt = ctx;
+	guard = ctxt->_private;
+
+	guard->depth++;
+	guard->nodes++;
+
+	if (guard->dropped != NULL)
+		limits_release_dropped (guard);
+
+	if (guard->limits->max_depth != 0 && guard->depth > guard->limits->max_depth)
+		limits_stop (ctxt, guard, "depth");
+	else if (guard->limits->max_nodes != 0 && guard->nodes > guard->limits->max_nodes)
+		limits_stop (ctxt, guard, "number of nodes");
+	else if (guard->limits->max_attributes != 0 && (guint) nb_attributes > guard->limits->max_attributes)
+		limits_stop (ctxt, guard, "number of attributes");
+	else if (limits_add_text (ctxt, guard, limits_attributes_size (nb_attributes, attributes)) &&
+	         (guard->nodes % XML_LIMITS_CLOCK_STEP != 0 || limits_check_time (ctxt, guard)))
+		guard->sax.startElementNs (ctx, localname, prefix, URI, nb_namespaces, namespaces, nb_attributes, nb_defaulted, attributes);
+}
+
+static void
+limits_end_element (void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI)
+{
+	xmlNodePtr node;
+	XmlLimitsGuard *guard;
+
+	guard = ((xmlParserCtxtPtr) ctx)->_private;
+	guard->depth--;
+
+	node = ((xmlParserCtxtPtr) ctx)->node;
+	guard->sax.endElementNs (ctx, localname, prefix, URI);
+
+	if (guard->element_func != NULL && node != NULL)
+		guard->element_func (node, guard->element_data);
+}
+
+/* the values of attributes count as text as well */
+static gboolean
+limits_add_text (xmlParserCtxtPtr ctxt, XmlLimitsGuard *guard, gsize len)
+{
+	guard->text += len;
+
+	if (guard->limits->max_text_size != 0 && guard->text > guard->limits->max_text_size) {
+		limits_stop (ctxt, guard, "text size");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+limits_characters (void *ctx, const xmlChar *ch, int len)
+{
+	XmlLimitsGuard *guard;
+
+	guard = ((xmlParserCtxtPtr) ctx)->_private;
+	if (limits_add_text (ctx, guard, len))
+		guard->sax.characters (ctx, ch, len);
+}
+
+static void
+limits_cdata_block (void *ctx, const xmlChar *value, int len)
+{
+	XmlLimitsGuard *guard;
+
+	guard = ((xmlParserCtxtPtr) ctx)->_private;
+	if (limits_add_text (ctx, guard, len))
+		guard->sax.cdataBlock (ctx, value, len);
+}
+
+/* predefined entities (as &amp;) are resolved by libxml2 without asking */
+static xmlEntityPtr
+limits_get_entity (void *ctx, const xmlChar *name)
+{
+	xmlParserCtxtPtr ctxt;
+	XmlLimitsGuard *guard;
+
+	ctxt = ctx;
+	guard = ctxt->_private;
+	guard->entities++;
+
+	if (guard->limits->max_entities != 0 && guard->entities > guard->limits->max_entities) {
+		limits_stop (ctxt, guard, "number of entities");
+		return NULL;
+	}
+
+	if (limits_check_time (ctxt, guard) == FALSE)
+		return NULL;
+
+	return guard->sax.getEntity (ctx, name);
+}
+
+static void
+limits_install (xmlParserCtxtPtr ctxt, XmlLimitsGuard *guard, const GrssFeedParserLimits *limits)
+{
+	memset (guard, 0, sizeof (XmlLimitsGuard));
+	guard->limits = limits;
+	if (limits->max_parse_time != 0)
+		guard->deadline = g_get_monotonic_time () + (gint64) limits->max_parse_time * 1000;
+
+	guard->sax = *(ctxt->sax);
+	ctxt->sax->startElementNs = limits_start_element;
+	ctxt->sax->endElementNs = limits_end_element;
+	ctxt->sax->characters = limits_characters;
+	ctxt->sax->ignorableWhitespace = limits_characters;
+	ctxt->sax->cdataBlock = limits_cdata_block;
+	ctxt->sax->getEntity = limits_get_entity;
+	ctxt->_private = guard;
+}
+
+static xmlDocPtr
+limits_check_result (XmlLimitsGuard *guard, xmlDocPtr doc, GError **error)
+{
+	if (guard->exceeded != NULL) {
+		if (doc != NULL)
+			xmlFreeDoc (doc);
+		doc = NULL;
+
+		g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_LIMIT_EXCEEDED,
+		             "Document exceeds the limit on %s", guard->exceeded);
+	}
+
+	return doc;
+}
+
+static xmlDocPtr
+read_with_limits (xmlParserCtxtPtr ctxt, const gchar *contents, gsize size, const gchar *url, int options,
+                  const GrssFeedParserLimits *limits, GError **error)
+{
+	xmlDocPtr doc;
+	XmlLimitsGuard guard;
+
+	limits_install (ctxt, &guard, limits);
+
+	if (contents != NULL)
+		doc = xmlCtxtReadMemory (ctxt, contents, size, url, NULL, options | XML_QUIET_OPTIONS);
+	else
+		doc = xmlCtxtReadFile (ctxt, url, NULL, options | XML_QUIET_OPTIONS);
+
+	/* the SAX handler belongs to the context, which is reused later */
+	*(ctxt->sax) = guard.sax;
+	ctxt->_private = NULL;
+
+	return limits_check_result (&guard, doc, error);
+}
+
+static gboolean
+limits_are_set (const GrssFeedParserLimits *limits)
+{
+	return (limits != NULL && (limits->max_depth != 0 || limits->max_nodes != 0 || limits->max_attributes != 0 ||
+	        limits->max_text_size != 0 || limits->max_entities != 0 || limits->max_parse_time != 0));
+}
+
+/* if @contents is NULL, the document is read from the file in @url */
+static xmlDocPtr
+read_document (const gchar *contents, gsize size, const gchar *url, int options,
+               const GrssFeedParserLimits *limits, GError **error)
+{
+	xmlParserCtxtPtr ctxt;
+
+	xmlSetGenericErrorFunc (NULL, error_func);
+
+	ctxt = get_parser_context ();
+	if (ctxt == NULL) {
+		/* without a context of its own, the guard cannot be installed */
+		if (limits_are_set (limits)) {
+			g_set_error (error, GRSS_FEED_PARSER_ERROR, GRSS_FEED_PARSER_PARSE_ERROR, "Unable to create the parser");
+			return NULL;
+		}
+
+		if (contents != NULL)
+			return xmlReadMemory (contents, size, url, NULL, options | XML_QUIET_OPTIONS);
+		else
+			return xmlReadFile (url, NULL, options | XML_QUIET_OPTIONS);
+	}
+	else if (limits_are_set (limits)) {
+		return read_with_limits (ctxt, contents, size, url, options, limits, error);
+	}
+	else if (contents != NULL) {
+		return xmlCtxtReadMemory (ctxt, contents, size, url, NULL, options | XML_QUIET_OPTIONS);
+	}
+	else {
+		return xmlCtxtReadFile (ctxt, url, NULL, options | XML_QUIET_OPTIONS);
+	}
+}
+
+/*
+	If @limits is not NULL the document is read within them, and @error
+	is set when one is exceeded. The document must be freed in the
+	calling thread, see get_parser_context()
+*/
+xmlDocPtr
+content_to_xml_full (const gchar *contents, gsize size, const gchar *url, int options,
+                     const GrssFeedParserLimits *limits, GError **error)
+{
+	return read_document (contents, size, url, options, limits, error);
+}
+
+/*
+	To read a document a chunk at a time, so that the work can be split
+	across many iterations of the main loop, or the document consumed
+	while it is downloaded. The guard is always installed, to hook the
+	callbacks of the parser even when no limit is set
+*/
+struct _XmlPushReader {
+	xmlParserCtxtPtr ctxt;
+	XmlLimitsGuard guard;
+	GrssFeedParserLimits limits;
+};
+
+XmlPushReader*
+xml_push_reader_new (const gchar *url, int options, const GrssFeedParserLimits *limits)
+{
+	XmlPushReader *reader;
+
+	xmlSetGenericErrorFunc (NULL, error_func);
+
+	reader = g_new0 (XmlPushReader, 1);
+	reader->ctxt = xmlCreatePushParserCtxt (NULL, NULL, NULL, 0, url);
+	if (reader->ctxt == NULL) {
+		g_free (reader);
+		return NULL;
+	}
+
+	xmlCtxtUseOptions (reader->ctxt, options | XML_QUIET_OPTIONS);
+
+	if (limits != NULL)
+		reader->limits = *limits;
+	limits_install (reader->ctxt, &reader->guard, &reader->limits);
+
+	return reader;
+}
+
+/*
+	@func is invoked each time an element is closed, and the subtree
+	built for it is complete
+*/
+void
+xml_push_reader_set_element_func (XmlPushReader *reader, XmlPushElementFunc func, gpointer user_data)
+{
+	reader->guard.element_func = func;
+	reader->guard.element_data = user_data;
+}
+
+/*
+	To be called from the element function, to free @node (and everything
+	it contains) once it is no longer required
+*/
+void
+xml_push_reader_drop (XmlPushReader *reader, xmlNodePtr node)
+{
+	if (reader->guard.dropped != NULL)
+		limits_release_dropped (&reader->guard);
+
+	reader->guard.dropped = node;
+}
+
+/*
+	To move the limit on the parse time, as a monotonic time (or 0 for no
+	limit), when the document is not read all at once
+*/
+void
+xml_push_reader_set_deadline (XmlPushReader *reader, gint64 deadline)
+{
+	reader->guard.deadline = deadline;
+}
+
+/* no other chunk is read after this, as if the document was invalid */
+void
+xml_push_reader_stop (XmlPushReader *reader)
+{
+	xmlStopParser (reader->ctxt);
+}
+
+/* FALSE if the document is not valid, or exceeds the limits */
+gboolean
+xml_push_reader_feed (XmlPushReader *reader, const gchar *contents, gsize size)
+{
+	return (xmlParseChunk (reader->ctxt, contents, size, 0) == XML_ERR_OK);
+}
+
+/* consumes the @reader, returning the document or NULL if invalid */
+xmlDocPtr
+xml_push_reader_finish (XmlPushReader *reader, GError **error)
+{
+	xmlDocPtr doc;
+
+	xmlParseChunk (reader->ctxt, NULL, 0, 1);
+
+	if (reader->guard.dropped != NULL)
+		limits_release_dropped (&reader->guard);
+
+	doc = reader->ctxt->myDoc;
+	reader->ctxt->myDoc = NULL;
+
+	if (doc != NULL && reader->ctxt->wellFormed == 0) {
+		xmlFreeDoc (doc);
+		doc = NULL;
+	}
+
+	doc = limits_check_result (&reader->guard, doc, error);
+
+	xml_push_reader_free (reader);
+	return doc;
+}
+
+void
+xml_push_reader_free (XmlPushReader *reader)
+{
+	if (reader->ctxt->myDoc != NULL)
+		xmlFreeDoc (reader->ctxt->myDoc);
+
+	xmlFreeParserCtxt (reader->ctxt);
+	g_free (reader);
+}
+
+/*
+	Before the parsing, documents are brought to valid UTF-8, so that
+	libxml2 never fails or falls in its slow recovery paths due to the
+	encoding: legacy charsets are converted with iconv, a chunk at a
+	time, and invalid bytes found in UTF-8 documents are taken as
+	Windows-1252, which is what they usually are. Documents already valid
+	(most of them) are passed to the parser as they are, without copies
+*/
+
+#define UTF8_ASCII_MASK		G_GUINT64_CONSTANT (0x8080808080808080)
+#define UTF8_ONES		G_GUINT64_CONSTANT (0x0101010101010101)
+
+/* chars not permitted in XML documents, but for \t, \n and \r */
+#define IS_XML_CONTROL(__c)	((__c) < 0x20 && (__c) != '\t' && (__c) != '\n' && (__c) != '\r')
+
+/* Windows-1252 chars for 0x80-0x9F, the others are the same of Latin-1 */
+static const gunichar cp1252_high [] = {
+	0x20AC, 0xFFFD, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0xFFFD, 0x017D, 0xFFFD,
+	0xFFFD, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0xFFFD, 0x017E, 0x0178
+};
+
+struct _CharsetNormalizer {
+	gchar			*charset;
+	GIConv			conv;
+	gboolean		passthrough;
+	gboolean		xml;
+
+	/* bytes to drop at the beginning, as the byte order mark */
+	gsize			skip;
+
+	/* incomplete sequence at the end of the previous chunk */
+	gchar			carry [8];
+	gsize			carry_len;
+
+	GString			*out;
+	GrssFeedChannelEncoding	encoding;
+};
+
+/*
+	Returns the length of the UTF-8 sequence at @p, 0 if it is invalid, or
+	-1 if it is truncated by the end of the data
+*/
+static gint
+utf8_check_sequence (const guchar *p, gsize avail)
+{
+	gint i;
+	gint len;
+	guchar lo;
+	guchar hi;
+
+	lo = 0x80;
+	hi = 0xBF;
+
+	/* the ranges of table 3-7 of the Unicode standard */
+	if (p [0] >= 0xC2 && p [0] <= 0xDF) {
+		len = 2;
+	}
+	else if (p [0] >= 0xE0 && p [0] <= 0xEF) {
+		len = 3;
+		if (p [0] == 0xE0)
+			lo = 0xA0;
+		else if (p [0] == 0xED)
+			hi = 0x9F;
+	}
+	else if (p [0] >= 0xF0 && p [0] <= 0xF4) {
+		len = 4;
+		if (p [0] == 0xF0)
+			lo = 0x90;
+		else if (p [0] == 0xF4)
+			hi = 0x8F;
+	}
+	else {
+		return 0;
+	}
+
+	for (i = 1; i < len; i++) {
+		if (i >= avail)
+			return -1;
+		if (p [i] < lo || p [i] > hi)
+			return 0;
+
+		lo = 0x80;
+		hi = 0xBF;
+	}
+
+	return len;
+}
+
+/*
+	Returns the length of the longest prefix of @data which is valid UTF-8,
+	and has no control chars if @xml is TRUE. Runs of ASCII, which are most
+	of any feed, are checked eight bytes at a time
+*/
+gsize
+utf8_valid_prefix (const gchar *data, gsize size, gboolean xml)
+{
+	gint len;
+	guint64 word;
+	const guchar *p;
+	const guchar *end;
+
+	p = (const guchar*) data;
+	end = p + size;
+
+	while (p < end) {
+		while (end - p >= 8) {
+			memcpy (&word, p, 8);
+
+			/* a byte is non ASCII, or below 0x20 */
+			if ((word & UTF8_ASCII_MASK) != 0 ||
+			    (xml && ((word - UTF8_ONES * 0x20) & ~word & UTF8_ASCII_MASK) != 0))
+				break;
+
+			p += 8;
+		}
+
+		if (p >= end)
+			break;
+
+		if (*p < 0x80) {
+			if (xml && IS_XML_CONTROL (*p))
+				break;
+			p++;
+			continue;
+		}
+
+		len = utf8_check_sequence (p, end - p);
+		if (len <= 0)
+			break;
+		p += len;
+	}
+
+	return p - (const guchar*) data;
+}
+
+/*
+	TRUE if the Content-Type @content_type, eventually with parameters, has
+	the given @mime type
+*/
+gboolean
+content_type_is (const gchar *content_type, const gchar *mime)
+{
+	gsize len;
+
+	if (content_type == NULL)
+		return FALSE;
+
+	len = strlen (mime);
+	return (g_ascii_strncasecmp (content_type, mime, len) == 0 &&
+	        (content_type [len] == '\0' || content_type [len] == ';' || g_ascii_isspace (content_type [len])));
+}
+
+static gchar*
+content_type_charset (const gchar *content_type)
+{
+	gsize len;
+	const gchar *pos;
+
+	if (content_type == NULL)
+		return NULL;
+
+	for (pos = strchr (content_type, ';'); pos != NULL; pos = strchr (pos + 1, ';')) {
+		while (g_ascii_isspace (pos [1]))
+			pos++;
+
+		if (g_ascii_strncasecmp (pos + 1, "charset=", 8) == 0) {
+			pos += 9;
+			if (*pos == '"')
+				pos++;
+
+			len = strcspn (pos, "\"; \t");
+			return (len != 0 ? g_strndup (pos, len) : NULL);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+	The encoding found in the XML declaration, if any. Blanks before the
+	declaration, which make libxml2 fail, are to be dropped and counted in
+	@skip
+*/
+static gchar*
+xml_declared_charset (const gchar *data, gsize size, gsize *skip)
+{
+	gchar quote;
+	const gchar *pos;
+	const gchar *end;
+	const gchar *close;
+	const gchar *value;
+
+	end = data + MIN (size, 1024);
+
+	for (pos = data; pos < end && g_ascii_isspace (*pos); pos++);
+	if (end - pos < 6 || strncmp (pos, "<?xml", 5) != 0 || !g_ascii_isspace (pos [5]))
+		return NULL;
+
+	*skip += pos - data;
+
+	close = g_strstr_len (pos, end - pos, "?>");
+	if (close == NULL)
+		return NULL;
+
+	pos = g_strstr_len (pos, close - pos, "encoding");
+	if (pos == NULL)
+		return NULL;
+
+	for (pos += 8; pos < close && (g_ascii_isspace (*pos) || *pos == '='); pos++);
+	if (pos >= close || (*pos != '"' && *pos != '\''))
+		return NULL;
+
+	quote = *pos;
+	value = ++pos;
+
+	while (pos < close && *pos != quote)
+		pos++;
+
+	return (pos < close && pos != value ? g_strndup (value, pos - value) : NULL);
+}
+
+/*
+	As most feed readers do, the byte order mark and the XML declaration win
+	over the HTTP headers, as servers often report a wrong default charset
+*/
+static gchar*
+detect_charset (const gchar *data, gsize size, const gchar *content_type, gboolean xml, gsize *skip)
+{
+	gchar *ret;
+	const guchar *bytes;
+
+	bytes = (const guchar*) data;
+	*skip = 0;
+
+	if (size >= 3 && bytes [0] == 0xEF && bytes [1] == 0xBB && bytes [2] == 0xBF) {
+		*skip = 3;
+		ret = g_strdup ("UTF-8");
+	}
+	else if (size >= 4 && bytes [0] == 0xFF && bytes [1] == 0xFE && bytes [2] == 0 && bytes [3] == 0) {
+		*skip = 4;
+		return g_strdup ("UTF-32LE");
+	}
+	else if (size >= 2 && bytes [0] == 0xFF && bytes [1] == 0xFE) {
+		*skip = 2;
+		return g_strdup ("UTF-16LE");
+	}
+	else if (size >= 2 && bytes [0] == 0xFE && bytes [1] == 0xFF) {
+		*skip = 2;
+		return g_strdup ("UTF-16BE");
+	}
+	else if (xml && size >= 4 && bytes [0] == '<' && bytes [1] == 0 && bytes [2] == '?' && bytes [3] == 0) {
+		return g_strdup ("UTF-16LE");
+	}
+	else if (xml && size >= 4 && bytes [0] == 0 && bytes [1] == '<' && bytes [2] == 0 && bytes [3] == '?') {
+		return g_strdup ("UTF-16BE");
+	}
+	else {
+		ret = NULL;
+	}
+
+	/* blanks before the declaration are dropped also with a byte order mark */
+	if (xml) {
+		data += *skip;
+		size -= *skip;
+
+		if (ret == NULL)
+			ret = xml_declared_charset (data, size, skip);
+		else
+			g_free (xml_declared_charset (data, size, skip));
+	}
+
+	if (ret == NULL)
+		ret = content_type_charset (content_type);
+
+	return ret;
+}
+
+static gboolean
+charset_is_utf8 (const gchar *charset)
+{
+	return (charset == NULL || !g_ascii_strcasecmp (charset, "UTF-8") || !g_ascii_strcasecmp (charset, "UTF8") ||
+	        !g_ascii_strcasecmp (charset, "US-ASCII") || !g_ascii_strcasecmp (charset, "ASCII"));
+}
+
+/*
+	@content_type is the value of the Content-Type HTTP header, if any. The
+	first bytes of the document, which are used to detect the charset, have
+	to be passed in @data
+*/
+CharsetNormalizer*
+charset_normalizer_new (const gchar *data, gsize size, const gchar *content_type, gboolean xml)
+{
+	const gchar *from;
+	CharsetNormalizer *normalizer;
+
+	normalizer = g_new0 (CharsetNormalizer, 1);
+	normalizer->xml = xml;
+	normalizer->conv = (GIConv) -1;
+	normalizer->out = g_string_new (NULL);
+	normalizer->charset = detect_charset (data, size, content_type, xml, &normalizer->skip);
+
+	if (charset_is_utf8 (normalizer->charset)) {
+		normalizer->encoding = GRSS_FEED_CHANNEL_ENCODING_UTF8;
+	}
+	else {
+		/* Latin-1 is often used for Windows-1252, which is a superset */
+		from = normalizer->charset;
+		if (!g_ascii_strcasecmp (from, "ISO-8859-1") || !g_ascii_strcasecmp (from, "ISO8859-1") || !g_ascii_strcasecmp (from, "LATIN1"))
+			from = "WINDOWS-1252";
+
+		normalizer->conv = g_iconv_open ("UTF-8", from);
+
+		if (normalizer->conv != (GIConv) -1) {
+			normalizer->encoding = GRSS_FEED_CHANNEL_ENCODING_TRANSCODED;
+		}
+		else {
+			normalizer->encoding = GRSS_FEED_CHANNEL_ENCODING_UNSUPPORTED;
+			normalizer->passthrough = TRUE;
+			normalizer->skip = 0;
+		}
+	}
+
+	return normalizer;
+}
+
+static void
+normalizer_append_repaired (CharsetNormalizer *normalizer, guchar byte)
+{
+	normalizer->encoding = GRSS_FEED_CHANNEL_ENCODING_REPAIRED;
+
+	/* control chars are just dropped */
+	if (byte >= 0x80 && byte < 0xA0)
+		g_string_append_unichar (normalizer->out, cp1252_high [byte - 0x80]);
+	else if (byte >= 0xA0)
+		g_string_append_unichar (normalizer->out, byte);
+}
+
+static void
+normalizer_repair (CharsetNormalizer *normalizer, const gchar *data, gsize size, gboolean last)
+{
+	gsize valid;
+	const gchar *end;
+
+	end = data + size;
+
+	while (data < end) {
+		valid = utf8_valid_prefix (data, end - data, normalizer->xml);
+		g_string_append_len (normalizer->out, data, valid);
+		data += valid;
+
+		if (data >= end)
+			break;
+
+		if (last == FALSE && end - data < 4 && utf8_check_sequence ((const guchar*) data, end - data) < 0) {
+			memcpy (normalizer->carry, data, end - data);
+			normalizer->carry_len = end - data;
+			break;
+		}
+
+		normalizer_append_repaired (normalizer, *data);
+		data++;
+	}
+}
+
+/* iconv may still emit control chars, which are not permitted in XML */
+static void
+normalizer_strip_controls (CharsetNormalizer *normalizer)
+{
+	gchar *in;
+	gchar *out;
+	gchar *end;
+
+	if (utf8_valid_prefix (normalizer->out->str, normalizer->out->len, TRUE) == normalizer->out->len)
+		return;
+
+	end = normalizer->out->str + normalizer->out->len;
+
+	for (in = out = normalizer->out->str; in < end; in++)
+		if (!IS_XML_CONTROL ((guchar) *in))
+			*out++ = *in;
+
+	g_string_truncate (normalizer->out, out - normalizer->out->str);
+	normalizer->encoding = GRSS_FEED_CHANNEL_ENCODING_REPAIRED;
+}
+
+static void
+normalizer_transcode (CharsetNormalizer *normalizer, const gchar *data, gsize size, gboolean last)
+{
+	gsize ret;
+	gsize used;
+	gsize in_left;
+	gsize out_left;
+	gchar *in;
+	gchar *out;
+
+	in = (gchar*) data;
+	in_left = size;
+	used = 0;
+
+	while (in_left > 0) {
+		/* usually enough for the whole chunk */
+		if (normalizer->out->len - used < 16)
+			g_string_set_size (normalizer->out, used + in_left * 2 + 16);
+
+		out = normalizer->out->str + used;
+		out_left = normalizer->out->len - used;
+
+		ret = g_iconv (normalizer->conv, &in, &in_left, &out, &out_left);
+		used = out - normalizer->out->str;
+
+		if (ret != (gsize) -1)
+			continue;
+
+		if (errno == E2BIG) {
+			g_string_set_size (normalizer->out, normalizer->out->len * 2);
+		}
+		else if (errno == EINVAL && last == FALSE && in_left <= sizeof (normalizer->carry)) {
+			memcpy (normalizer->carry, in, in_left);
+			normalizer->carry_len = in_left;
+			break;
+		}
+		else {
+			/* invalid or truncated sequence, a single byte is replaced */
+			g_string_set_size (normalizer->out, used);
+			g_string_append_unichar (normalizer->out, 0xFFFD);
+			used = normalizer->out->len;
+			normalizer->encoding = GRSS_FEED_CHANNEL_ENCODING_REPAIRED;
+			in++;
+			in_left--;
+		}
+	}
+
+	g_string_set_size (normalizer->out, used);
+
+	if (normalizer->xml)
+		normalizer_strip_controls (normalizer);
+}
+
+/*
+	Normalizes the next chunk of the document, returning the UTF-8 contents
+	to pass to the parser and their length in @out_size. Those are @data
+	itself when it needs no changes, or an internal buffer valid until the
+	next call. @last is TRUE for the last chunk
+*/
+const gchar*
+charset_normalizer_feed (CharsetNormalizer *normalizer, const gchar *data, gsize size, gboolean last, gsize *out_size)
+{
+	gsize drop;
+	gsize valid;
+	GString *joined;
+
+	drop = MIN (normalizer->skip, size);
+	data += drop;
+	size -= drop;
+	normalizer->skip -= drop;
+
+	if (normalizer->passthrough) {
+		*out_size = size;
+		return data;
+	}
+
+	joined = NULL;
+
+	/* rare enough to just copy the chunk */
+	if (normalizer->carry_len != 0) {
+		joined = g_string_sized_new (normalizer->carry_len + size);
+		g_string_append_len (joined, normalizer->carry, normalizer->carry_len);
+		g_string_append_len (joined, data, size);
+		data = joined->str;
+		size = joined->len;
+		normalizer->carry_len = 0;
+	}
+
+	g_string_truncate (normalizer->out, 0);
+
+	if (normalizer->conv != (GIConv) -1) {
+		normalizer_transcode (normalizer, data, size, last);
+	}
+	else {
+		valid = utf8_valid_prefix (data, size, normalizer->xml);
+
+		if (valid == size && joined == NULL) {
+			*out_size = size;
+			return data;
 		}
-	}
-	else if (xhtmlMode == 1 || xhtmlMode == 2) { /* Read multiple XHTML tags and embed in div tag */
-		xmlNodePtr copiedNodes = xmlDocCopyNodeList (newDoc, xml->xmlChildrenNode);
-		xmlAddChildList (divNode, copiedNodes);
-	}
 
-	buf = xmlBufferCreate ();
-	xmlNodeDump (buf, newDoc, xmlDocGetRootElement (newDoc), 0, 0 );
+		normalizer_repair (normalizer, data, size, last);
+	}
 
-	if (xmlBufferLength (buf) > 0)
-		result = (gchar*) xmlCharStrdup ((gchar*) xmlBufferContent (buf));
+	if (joined != NULL)
+		g_string_free (joined, TRUE);
 
-	xmlBufferFree (buf);
-	xmlFreeDoc (newDoc);
-	return result;
+	*out_size = normalizer->out->len;
+	return normalizer->out->str;
 }
 
 /*
-	Just to suppress output from libxml2
+	TRUE if the contents returned by charset_normalizer_feed() are UTF-8,
+	whatever encoding is declared into the document
 */
+gboolean
+charset_normalizer_is_utf8 (CharsetNormalizer *normalizer)
+{
+	return (normalizer->passthrough == FALSE);
+}
+
+GrssFeedChannelEncoding
+charset_normalizer_get_encoding (CharsetNormalizer *normalizer)
+{
+	return normalizer->encoding;
+}
+
+const gchar*
+charset_normalizer_get_charset (CharsetNormalizer *normalizer)
+{
+	return normalizer->charset;
+}
+
 void
-error_func (void * ctx, const char * msg, ...)
+charset_normalizer_free (CharsetNormalizer *normalizer)
 {
-	return;
+	if (normalizer->conv != (GIConv) -1)
+		g_iconv_close (normalizer->conv);
+
+	g_string_free (normalizer->out, TRUE);
+	g_free (normalizer->charset);
+	g_free (normalizer);
 }
 
 xmlDocPtr
 content_to_xml (const gchar *contents, gsize size)
 {
-	xmlSetGenericErrorFunc (NULL, error_func);
-	return xmlParseMemory (contents, size);
+	return content_to_xml_full (contents, size, NULL, XML_DEFAULT_OPTIONS, NULL, NULL);
+}
+
+/* files compressed with gzip, that libxml2 decompresses while reading them */
+gboolean
+is_gzip_data (const gchar *data, gsize size)
+{
+	return (size >= 2 && (guchar) data [0] == 0x1f && (guchar) data [1] == 0x8b);
+}
+
+/*
+	The file is mapped in memory and parsed directly from the mapping,
+	avoiding the copy of the buffered I/O of xmlReadFile(). The path is
+	still passed as URL of the document, to resolve relative references.
+	Compressed files are left to xmlReadFile(), which inflates them
+*/
+xmlDocPtr
+file_to_xml_full (const gchar *path, int options, const GrssFeedParserLimits *limits, GError **error)
+{
+	gsize size;
+	const gchar *contents;
+	xmlDocPtr doc;
+	GMappedFile *mapped;
+
+	mapped = g_mapped_file_new (path, FALSE, error);
+	if (mapped == NULL)
+		return NULL;
+
+	doc = NULL;
+	size = g_mapped_file_get_length (mapped);
+	contents = g_mapped_file_get_contents (mapped);
+
+	if (contents != NULL && is_gzip_data (contents, size))
+		doc = read_document (NULL, 0, path, options, limits, error);
+	else if (contents != NULL && size != 0)
+		doc = read_document (contents, size, path, options, limits, error);
+
+	g_mapped_file_unref (mapped);
+	return doc;
 }
 
 xmlDocPtr
 file_to_xml (const gchar *path)
 {
-	xmlSetGenericErrorFunc (NULL, error_func);
-	return xmlParseFile (path);
+	return file_to_xml_full (path, XML_DEFAULT_OPTIONS, NULL, NULL);
 }
 
 /* in theory, we'd need only the RFC822 timezones here
-   in practice, feeds also use other timezones...        */
-static struct {
+   in practice, feeds also use other timezones...
+   The table is sorted by name, to be searched with bsearch() */
+typedef struct {
 	const char *name;
 	int offset;
-} tz_offsets [] = {
-	{ "IDLW", -1200 },
-	{ "HAST", -1000 },
-	{ "AKST", -900 },
+} TzOffset;
+
+static const TzOffset tz_offsets [] = {
+	{ "A", -100 },
+	{ "ACDT", 1030 },
+	{ "ACST", 930 },
+	{ "ADT", -300 },
+	{ "AEDT", 1100 },
+	{ "AEST", 1000 },
 	{ "AKDT", -800 },
-	{ "WESZ", 100 },
-	{ "WEST", 100 },
-	{ "WEDT", 100 },
-	{ "MEST", 200 },
-	{ "MESZ", 200 },
-	{ "CEST", 200 },
+	{ "AKST", -900 },
+	{ "AST", -400 },
+	{ "BT", 300 },
+	{ "CDT", -500 },
 	{ "CEDT", 200 },
-	{ "EEST", 300 },
-	{ "EEDT", 300 },
-	{ "IRST", 430 },
+	{ "CEST", 200 },
+	{ "CET", 100 },
 	{ "CNST", 800 },
-	{ "ACST", 930 },
-	{ "ACDT", 1030 },
-	{ "AEST", 1000 },
-	{ "AEDT", 1100 },
-	{ "IDLE", 1200 },
-	{ "NZST", 1200 },
-	{ "NZDT", 1300 },
-	{ "GMT", 0 },
-	{ "EST", -500 },
-	{ "EDT", -400 },
 	{ "CST", -600 },
-	{ "CDT", -500 },
-	{ "MST", -700 },
-	{ "MDT", -600 },
-	{ "PST", -800 },
-	{ "PDT", -700 },
+	{ "EDT", -400 },
+	{ "EEDT", 300 },
+	{ "EEST", 300 },
+	{ "EET", 200 },
+	{ "EST", -500 },
+	{ "GMT", 0 },
+	{ "HAST", -1000 },
 	{ "HDT", -900 },
-	{ "YST", -900 },
-	{ "YDT", -800 },
-	{ "AST", -400 },
-	{ "ADT", -300 },
-	{ "VST", -430 },
-	{ "NST", -330 },
-	{ "NDT", -230 },
-	{ "WET", 0 },
-	{ "WEZ", 0 },
+	{ "ICT", 700 },
+	{ "IDLE", 1200 },
+	{ "IDLW", -1200 },
+	{ "IRST", 430 },
+	{ "IRT", 330 },
 	{ "IST", 100 },
-	{ "CET", 100 },
+	{ "JST", 900 },
+	{ "M", -1200 },
+	{ "MDT", -600 },
+	{ "MEST", 200 },
+	{ "MESZ", 200 },
 	{ "MEZ", 100 },
-	{ "EET", 200 },
-	{ "MSK", 300 },
 	{ "MSD", 400 },
-	{ "IRT", 330 },
-	{ "IST", 530 },
-	{ "ICT", 700 },
-	{ "JST", 900 },
+	{ "MSK", 300 },
+	{ "MST", -700 },
+	{ "N", 100 },
+	{ "NDT", -230 },
 	{ "NFT", 1130 },
-	{ "UT", 0 },
+	{ "NST", -330 },
+	{ "NZDT", 1300 },
+	{ "NZST", 1200 },
+	{ "PDT", -700 },
+	{ "PST", -800 },
 	{ "PT", -800 },
-	{ "BT", 300 },
-	{ "Z", 0 },
-	{ "A", -100 },
-	{ "M", -1200 },
-	{ "N", 100 },
-	{ "Y", 1200 }
+	{ "UT", 0 },
+	{ "VST", -430 },
+	{ "WEDT", 100 },
+	{ "WEST", 100 },
+	{ "WESZ", 100 },
+	{ "WET", 0 },
+	{ "WEZ", 0 },
+	{ "Y", 1200 },
+	{ "YDT", -800 },
+	{ "YST", -900 },
+	{ "Z", 0 }
 };
 
+#define TZ_NAME_MAX	4
+
+static const char *month_names = "janfebmaraprmayjunjulaugsepoctnovdec";
+
+/*
+ * Number of days between 1970-01-01 and the given date of the proleptic
+ * Gregorian calendar. Out of range days are just added, as mktime() would
+ * do normalizing them
+ */
+static gint64
+days_from_civil (gint year, gint month, gint day)
+{
+	gint era;
+	gint yoe;
+	gint doy;
+	gint doe;
+
+	if (month <= 2)
+		year--;
+
+	era = (year >= 0 ? year : year - 399) / 400;
+	yoe = year - era * 400;
+	doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return (gint64) era * 146097 + doe - 719468;
+}
+
+static time_t
+make_utc_time (gint year, gint month, gint day, gint hour, gint min, gint sec)
+{
+	return (time_t) (days_from_civil (year, month, day) * 86400 + hour * 3600 + min * 60 + sec);
+}
+
+static const char*
+parse_digits (const char *pos, gint min_digits, gint max_digits, gint *value)
+{
+	gint i;
+	gint ret;
+
+	ret = 0;
+
+	for (i = 0; i < max_digits && pos [i] >= '0' && pos [i] <= '9'; i++)
+		ret = ret * 10 + (pos [i] - '0');
+
+	if (i < min_digits)
+		return NULL;
+
+	*value = ret;
+	return pos + i;
+}
+
+static inline const char*
+skip_spaces (const char *pos)
+{
+	while (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')
+		pos++;
+	return pos;
+}
+
+static int
+tz_offsets_compare (const void *a, const void *b)
+{
+	return strcmp (((const TzOffset*) a)->name, ((const TzOffset*) b)->name);
+}
+
+/*
+ * Returns the offset, in seconds, of the timezone found at @token. Both
+ * numeric ("+0100", "-05:00") and named timezones are accepted, the
+ * latter matching the longest known prefix of the name ("UTC" is "UT")
+ */
 static time_t
-date_parse_rfc822_tz (char *token)
+date_parse_rfc822_tz (const char *token)
 {
-	int offset = 0;
-	const char *inptr = token;
-	int num_timezones;
+	int i;
+	int len;
+	int hours;
+	int minutes;
+	char name [TZ_NAME_MAX + 1];
+	const char *inptr;
+	TzOffset key;
+	TzOffset *found;
 
-	num_timezones = sizeof (tz_offsets) / sizeof ((tz_offsets) [0]);
+	inptr = token;
 
 	if (*inptr == '+' || *inptr == '-') {
-		offset = atoi (inptr);
+		hours = 0;
+		minutes = 0;
+
+		for (i = 1; i < 5 && g_ascii_isdigit (inptr [i]); i++);
+		len = i - 1;
+
+		if (len == 4) {
+			parse_digits (inptr + 1, 2, 2, &hours);
+			parse_digits (inptr + 3, 2, 2, &minutes);
+		}
+		else if (len == 3) {
+			parse_digits (inptr + 1, 1, 1, &hours);
+			parse_digits (inptr + 2, 2, 2, &minutes);
+		}
+		else if (len > 0) {
+			parse_digits (inptr + 1, 1, 2, &hours);
+			if (inptr [len + 1] == ':')
+				parse_digits (inptr + len + 2, 1, 2, &minutes);
+		}
+
+		return (*inptr == '-' ? -60 : 60) * (hours * 60 + minutes);
 	}
-	else {
-		int t;
 
-		if (*inptr == '(')
-			inptr++;
+	if (*inptr == '(')
+		inptr++;
 
-		for (t = 0; t < num_timezones; t++)
-			if (!strncmp (inptr, tz_offsets [t].name, strlen (tz_offsets [t].name))) {
-				offset = tz_offsets [t].offset;
-				break;
-			}
+	for (len = 0; len < TZ_NAME_MAX && g_ascii_isalpha (inptr [len]); len++)
+		name [len] = g_ascii_toupper (inptr [len]);
+
+	key.name = name;
+
+	for (; len > 0; len--) {
+		name [len] = '\0';
+		found = bsearch (&key, tz_offsets, G_N_ELEMENTS (tz_offsets), sizeof (TzOffset), tz_offsets_compare);
+		if (found != NULL)
+			return 60 * ((found->offset / 100) * 60 + (found->offset % 100));
 	}
 
-	return 60 * ((offset / 100) * 60 + (offset % 100));
+	return 0;
 }
 
 time_t
 date_parse_RFC822 (const gchar *date)
 {
-	struct tm tm;
-	time_t t;
-	time_t t2;
-	char *oldlocale;
-	char *pos;
-	gboolean success = FALSE;
-
-	memset (&tm, 0, sizeof (struct tm));
+	gint i;
+	gint day;
+	gint month;
+	gint year;
+	gint hour;
+	gint min;
+	gint sec;
+	const char *pos;
+	const char *end;
 
 	/* we expect at least something like "03 Dec 12 01:38:34"
 	   and don't require a day of week or the timezone
 
 	   the most specific format we expect:  "Fri, 03 Dec 12 01:38:34 CET"
+
+	   Everything is parsed by hand: strptime() and mktime() depend on
+	   the current locale and timezone, which are process-wide settings
 	 */
 
 	/* skip day of week */
-	pos = g_utf8_strchr (date, -1, ',');
+	pos = strchr (date, ',');
 	if (pos)
-		date = ++pos;
-
-	/* we expect English month names, so we set the locale */
-	oldlocale = g_strdup (setlocale (LC_TIME, NULL));
-	setlocale (LC_TIME, "C");
-
-	/* standard format with seconds and 4 digit year */
-	if (NULL != (pos = strptime ((const char*) date, " %d %b %Y %T", &tm)))
-		success = TRUE;
-	/* non-standard format without seconds and 4 digit year */
-	else if (NULL != (pos = strptime ((const char*) date, " %d %b %Y %H:%M", &tm)))
-		success = TRUE;
-	/* non-standard format with seconds and 2 digit year */
-	else if (NULL != (pos = strptime ((const char*) date, " %d %b %y %T", &tm)))
-		success = TRUE;
-	/* non-standard format without seconds 2 digit year */
-	else if (NULL != (pos = strptime ((const char*) date, " %d %b %y %H:%M", &tm)))
-		success = TRUE;
-
-	while (pos && *pos != '\0' && isspace ((int) *pos))       /* skip whitespaces before timezone */
-		pos++;
+		date = pos + 1;
+
+	pos = skip_spaces (date);
+	pos = parse_digits (pos, 1, 2, &day);
+	if (pos == NULL)
+		return 0;
 
-	if (oldlocale) {
-		setlocale (LC_TIME, oldlocale);	/* and reset it again */
-		g_free (oldlocale);
+	/* English month name, abbreviated or not */
+	pos = skip_spaces (pos);
+	if (!g_ascii_isalpha (pos [0]) || !g_ascii_isalpha (pos [1]) || !g_ascii_isalpha (pos [2]))
+		return 0;
+
+	for (month = 0; month < 12; month++) {
+		for (i = 0; i < 3; i++)
+			if (g_ascii_tolower (pos [i]) != month_names [month * 3 + i])
+				break;
+		if (i == 3)
+			break;
 	}
 
-	if (success) {
-		if ((time_t)(-1) != (t = mktime (&tm))) {
-			/* GMT time, with no daylight savings time
-			   correction. (Usually, there is no daylight savings
-			   time since the input is GMT.) */
-			t = t - date_parse_rfc822_tz (pos);
-			t2 = mktime (gmtime (&t));
-			t = t - (t2 - t);
-			return t;
-		}
+	if (month == 12)
+		return 0;
+
+	month++;
+	pos += 3;
+	while (g_ascii_isalpha (*pos))
+		pos++;
+
+	/* 4 digits year, or 2 digits with the same pivot of strptime("%y") */
+	pos = skip_spaces (pos);
+	end = parse_digits (pos, 2, 4, &year);
+	if (end == NULL || end - pos == 3)
+		return 0;
+	if (end - pos == 2)
+		year += (year < 69) ? 2000 : 1900;
+	pos = end;
+
+	/* time, seconds are optional */
+	pos = skip_spaces (pos);
+	pos = parse_digits (pos, 1, 2, &hour);
+	if (pos == NULL || *pos != ':')
+		return 0;
+
+	pos = parse_digits (pos + 1, 1, 2, &min);
+	if (pos == NULL)
+		return 0;
+
+	sec = 0;
+	if (*pos == ':') {
+		pos = parse_digits (pos + 1, 1, 2, &sec);
+		if (pos == NULL)
+			return 0;
 	}
 
-	return 0;
+	if (day < 1 || day > 31 || hour > 23 || min > 59 || sec > 60)
+		return 0;
+
+	pos = skip_spaces (pos);
+	return make_utc_time (year, month, day, hour, min, sec) - date_parse_rfc822_tz (pos);
 }
 
 time_t
 date_parse_ISO8601 (const gchar *date)
 {
-	struct tm tm;
-	time_t t;
-	time_t t2;
+	gint year;
+	gint month;
+	gint day;
+	gint hour;
+	gint min;
+	gint sec;
+	gint tz_hours;
+	gint tz_minutes;
 	time_t offset = 0;
-	gboolean success = FALSE;
-	gchar *pos;
+	const char *pos;
 
 	g_assert (date != NULL);
 
-	memset (&tm, 0, sizeof (struct tm));
-
 	/* we expect at least something like "2003-08-07T15:28:19" and
 	   don't require the second fractions and the timezone info
 
 	   the most specific format:   YYYY-MM-DDThh:mm:ss.sTZD
 	 */
 
-	/* full specified variant */
-	pos = strptime (date, "%t%Y-%m-%dT%H:%M%t", &tm);
-	if (pos) {
+	pos = skip_spaces (date);
+	pos = parse_digits (pos, 1, 4, &year);
+	if (pos == NULL || *pos != '-')
+		return 0;
+
+	pos = parse_digits (pos + 1, 1, 2, &month);
+	if (pos == NULL || *pos != '-')
+		return 0;
+
+	pos = parse_digits (pos + 1, 1, 2, &day);
+	if (pos == NULL || month < 1 || month > 12 || day < 1 || day > 31)
+		return 0;
+
+	hour = 0;
+	min = 0;
+	sec = 0;
+
+	/* full specified variant, otherwise only the date */
+	if ((*pos == 'T' || *pos == 't' || *pos == ' ') && g_ascii_isdigit (pos [1])) {
+		pos = parse_digits (pos + 1, 1, 2, &hour);
+		if (pos == NULL || *pos != ':')
+			return 0;
+
+		pos = parse_digits (pos + 1, 1, 2, &min);
+		if (pos == NULL || hour > 23 || min > 59)
+			return 0;
+
+		pos = skip_spaces (pos);
+
 		/* Parse seconds */
 		if (*pos == ':')
 			pos++;
 
-		if (isdigit (pos [0]) && !isdigit (pos [1])) {
-			tm.tm_sec = pos[0] - '0';
-			pos++;
-		}
-		else if (isdigit (pos [0]) && isdigit (pos [1])) {
-			tm.tm_sec = 10 * (pos [0] - '0') + pos [1] - '0';
-			pos += 2;
+		if (g_ascii_isdigit (*pos)) {
+			pos = parse_digits (pos, 1, 2, &sec);
+			if (sec > 60)
+				return 0;
 		}
 
 		/* Parse second fractions */
 		if (*pos == '.') {
-			while (*pos == '.' || isdigit (pos [0]))
+			while (*pos == '.' || g_ascii_isdigit (*pos))
 				pos++;
 		}
 
 		/* Parse timezone */
-		if (*pos == 'Z') {
-			offset = 0;
-		}
-		else if ((*pos == '+' || *pos == '-') && isdigit (pos [1]) && isdigit (pos [2]) && strlen (pos) >= 3) {
-			offset = (10 * (pos [1] - '0') + (pos [2] - '0')) * 60 * 60;
-
-			if (pos [3] == ':' && isdigit (pos [4]) && isdigit (pos [5]))
-				offset +=  (10 * (pos [4] - '0') + (pos [5] - '0')) * 60;
-			else if (isdigit (pos [3]) && isdigit (pos [4]))
-				offset +=  (10 * (pos [3] - '0') + (pos [4] - '0')) * 60;
-
-			offset *= (pos [0] == '+') ? 1 : -1;
-		}
-
-		success = TRUE;
-	}
-
-	/* only date */
-	else if (NULL != strptime (date, "%t%Y-%m-%d", &tm)) {
-		success = TRUE;
-	}
-
-	/* there were others combinations too... */
-
-	if (success) {
-		if ((time_t)(-1) != (t = mktime (&tm))) {
-			/* Correct for the local timezone*/
-			struct tm tmp_tm;
-
-			t = t - offset;
-			gmtime_r (&t, &tmp_tm);
-			t2 = mktime (&tmp_tm);
-			t = t - (t2 - t);
-
-			return t;
+		if ((*pos == '+' || *pos == '-') && g_ascii_isdigit (pos [1]) && g_ascii_isdigit (pos [2])) {
+			parse_digits (pos + 1, 2, 2, &tz_hours);
+			tz_minutes = 0;
+
+			if (pos [3] == ':' && g_ascii_isdigit (pos [4]) && g_ascii_isdigit (pos [5]))
+				parse_digits (pos + 4, 2, 2, &tz_minutes);
+			else if (g_ascii_isdigit (pos [3]) && g_ascii_isdigit (pos [4]))
+				parse_digits (pos + 3, 2, 2, &tz_minutes);
+
+			offset = (tz_hours * 60 + tz_minutes) * 60;
+			if (*pos == '-')
+				offset = -offset;
 		}
 	}
 
-	return 0;
+	return make_utc_time (year, month, day, hour, min, sec) - offset;
 }
 
 gchar*
@@ -595,6 +2615,69 @@ address_seems_public (GInetAddress *addr)
 	        g_inet_address_get_is_mc_global (addr) == FALSE);
 }
 
+typedef enum {
+	URL_INVALID,
+	URL_VALID,
+	URL_UNSURE
+} UrlCheck;
+
+/*
+	Most of the URLs found in feeds are plain http(s) addresses, which are
+	checked here without allocations. Those with unusual contents (user
+	info, IPv6 addresses, escapes, whitespaces...) are reported as unsure,
+	and have to be parsed with SoupURI
+*/
+static UrlCheck
+quick_test_url (const gchar *url)
+{
+	const gchar *p;
+	const gchar *host;
+	const gchar *host_end;
+
+	p = url;
+
+	if (g_ascii_strncasecmp (p, "http", 4) != 0)
+		return g_ascii_isspace (*p) ? URL_UNSURE : URL_INVALID;
+
+	p += 4;
+	if (*p == 's' || *p == 'S')
+		p++;
+	if (strncmp (p, "://", 3) != 0)
+		return URL_INVALID;
+
+	p += 3;
+	host = p;
+	host_end = NULL;
+
+	for (; *p != '\0' && *p != '/' && *p != '?' && *p != '#'; p++) {
+		if (g_ascii_isalnum (*p) || *p == '.' || *p == '-' || *p == '_')
+			continue;
+
+		if (*p != ':')
+			return URL_UNSURE;
+
+		host_end = p++;
+		while (g_ascii_isdigit (*p))
+			p++;
+
+		if (p == host_end + 1 || (*p != '\0' && *p != '/' && *p != '?' && *p != '#'))
+			return URL_UNSURE;
+
+		break;
+	}
+
+	if (host_end == NULL)
+		host_end = p;
+	if (host_end == host)
+		return URL_UNSURE;
+
+	for (; *p != '\0'; p++)
+		if ((guchar) *p <= ' ' || *p == 0x7F)
+			return URL_UNSURE;
+
+	return URL_VALID;
+}
+
 gboolean
 test_url (const gchar *url)
 {
@@ -604,6 +2687,15 @@ test_url (const gchar *url)
 	if (url == NULL)
 		return TRUE;
 
+	switch (quick_test_url (url)) {
+		case URL_VALID:
+			return TRUE;
+		case URL_INVALID:
+			return FALSE;
+		default:
+			break;
+	}
+
 	ret = TRUE;
 	test_uri = soup_uri_new (url);
 
@@ -620,3 +2712,79 @@ test_url (const gchar *url)
 	return ret;
 }
 
+
+/*
+	TRUE if @url is absolute and made only of chars libxml2 would neither
+	escape nor normalize, so that resolving it gives the same string. The
+	authority, if any, has to be a plain host name with an optional port
+*/
+static gboolean
+url_is_plain_absolute (const gchar *url)
+{
+	const gchar *p;
+
+	p = url;
+
+	if (g_ascii_isalpha (*p) == FALSE)
+		return FALSE;
+
+	for (p++; g_ascii_isalnum (*p) || *p == '+' || *p == '-' || *p == '.'; p++);
+	if (*p != ':')
+		return FALSE;
+
+	p++;
+
+	if (p [0] == '/' && p [1] == '/') {
+		p += 2;
+		if (g_ascii_isalnum (*p) == FALSE)
+			return FALSE;
+
+		for (; g_ascii_isalnum (*p) || *p == '.' || *p == '-'; p++);
+
+		/* a port 0, or with leading zeros, is dropped or rewritten */
+		if (*p == ':') {
+			p++;
+			if (*p < '1' || *p > '9')
+				return FALSE;
+
+			while (g_ascii_isdigit (*p))
+				p++;
+		}
+
+		if (*p != '\0' && *p != '/' && *p != '?')
+			return FALSE;
+	}
+
+	for (; *p != '\0'; p++)
+		if (g_ascii_isalnum (*p) == FALSE && strchr ("-._~:/?@!$&'()*+,;=", *p) == NULL)
+			return FALSE;
+
+	return TRUE;
+}
+
+/*
+	Resolves @url against @base, which has to be already escaped with
+	xmlURIEscape() and may be NULL. Absolute URLs with no special chars,
+	which are most of those found in feeds, are just copied without
+	parsing anything. Returns NULL if @url is not valid
+*/
+gchar*
+resolve_url (const gchar *url, const gchar *base)
+{
+	xmlChar *ret;
+	xmlChar *escaped;
+
+	if (url == NULL)
+		return NULL;
+
+	if (url_is_plain_absolute (url))
+		return g_strdup (url);
+
+	escaped = xmlURIEscape (BAD_CAST url);
+	if (escaped == NULL || base == NULL)
+		return (gchar*) escaped;
+
+	ret = xmlBuildURI (escaped, BAD_CAST base);
+	xmlFree (escaped);
+	return (gchar*) ret;
+}
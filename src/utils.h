@@ -38,6 +38,8 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 
+#include <libxml/parserInternals.h>
+
 #include "libgrss.h"
 
 #define PACKAGE			"libgrss"
@@ -45,13 +47,51 @@
 #define FREE_STRING(__str)	if (__str) { g_free (__str); __str = NULL; }
 #define FREE_OBJECT(__obj)	if (__obj) { g_object_unref (__obj); __obj = NULL; }
 #define SET_STRING(__str)	(__str == NULL ? NULL : g_strdup (__str))
+#define FREE_INTERNED(__str)	if (__str) { release_string (__str); __str = NULL; }
 
 gchar*		unhtmlize		(gchar *string);
 gchar*		unxmlize		(gchar * string);
 gchar*		xhtml_extract		(xmlNodePtr xml, gint xhtmlMode, const gchar *defaultBase);
+gchar*		xhtml_root_namespaces	(xmlDocPtr doc);
+gchar*		xhtml_lazy_base		(xmlNodePtr xml, const gchar *defaultBase);
+gchar*		xhtml_render_lazy	(const gchar *namespaces, const gchar *base, gchar *html);
+
+#define XML_DEFAULT_OPTIONS	GRSS_FEED_PARSER_XML_OPTIONS_DEFAULT
+
+gchar*		intern_string		(const gchar *string);
+gchar*		ref_string		(gchar *string);
+void		release_string		(gchar *string);
 
 xmlDocPtr	content_to_xml		(const gchar *contents, gsize size);
+xmlDocPtr	content_to_xml_full	(const gchar *contents, gsize size, const gchar *url, int options,
+					 const GrssFeedParserLimits *limits, GError **error);
 xmlDocPtr	file_to_xml		(const gchar *path);
+gboolean	is_gzip_data		(const gchar *data, gsize size);
+
+typedef struct _XmlPushReader	XmlPushReader;
+typedef void (*XmlPushElementFunc) (xmlNodePtr node, gpointer user_data);
+
+XmlPushReader*	xml_push_reader_new	(const gchar *url, int options, const GrssFeedParserLimits *limits);
+void		xml_push_reader_set_element_func	(XmlPushReader *reader, XmlPushElementFunc func, gpointer user_data);
+void		xml_push_reader_drop	(XmlPushReader *reader, xmlNodePtr node);
+void		xml_push_reader_stop	(XmlPushReader *reader);
+void		xml_push_reader_set_deadline	(XmlPushReader *reader, gint64 deadline);
+gboolean	xml_push_reader_feed	(XmlPushReader *reader, const gchar *contents, gsize size);
+xmlDocPtr	xml_push_reader_finish	(XmlPushReader *reader, GError **error);
+void		xml_push_reader_free	(XmlPushReader *reader);
+xmlDocPtr	file_to_xml_full	(const gchar *path, int options, const GrssFeedParserLimits *limits, GError **error);
+
+typedef struct _CharsetNormalizer	CharsetNormalizer;
+
+gsize			utf8_valid_prefix		(const gchar *data, gsize size, gboolean xml);
+gboolean		content_type_is			(const gchar *content_type, const gchar *mime);
+CharsetNormalizer*	charset_normalizer_new		(const gchar *data, gsize size, const gchar *content_type, gboolean xml);
+const gchar*		charset_normalizer_feed		(CharsetNormalizer *normalizer, const gchar *data, gsize size,
+							 gboolean last, gsize *out_size);
+gboolean		charset_normalizer_is_utf8	(CharsetNormalizer *normalizer);
+GrssFeedChannelEncoding	charset_normalizer_get_encoding	(CharsetNormalizer *normalizer);
+const gchar*		charset_normalizer_get_charset	(CharsetNormalizer *normalizer);
+void			charset_normalizer_free		(CharsetNormalizer *normalizer);
 
 time_t		date_parse_RFC822	(const gchar *date);
 time_t		date_parse_ISO8601	(const gchar *date);
@@ -61,5 +101,6 @@ GInetAddress*	detect_internet_address	();
 gboolean	address_seems_public	(GInetAddress *addr);
 
 gboolean	test_url		(const gchar *url);
+gchar*		resolve_url		(const gchar *url, const gchar *base);
 
 #endif /* __UTILS_LIBGRSS_H__ */